@@ -0,0 +1,147 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Peripherals of the mps2-an385 machine of QEMU, an MPS2 board with the
+ * Cortex-M3 FPGA image. The benchmarks are built for armv6-m, so that
+ * std::atomic goes through the intrinsics of this library, and armv6-m code
+ * runs unmodified on the Cortex-M3.
+ */
+
+#include <cstdint>
+
+#include "cortex_m_atomics/mmio.h"
+
+namespace benchmark {
+
+using cortex_m_atomics::mmio::Register;
+
+inline constexpr std::uint32_t kSystemClockHz = 25000000;
+
+// External interrupts
+inline constexpr unsigned kTimer0Irq = 8;
+inline constexpr unsigned kTimer1Irq = 9;
+inline constexpr unsigned kDualTimerIrq = 10;
+// Not connected to any peripheral, only pended by software
+inline constexpr unsigned kCommandIrq = 31;
+inline constexpr unsigned kNumIrqs = 32;
+
+/**
+ * @brief CMSDK APB timer. It counts down from the reload value at the system
+ * clock and interrupts when it reaches 0, reloading at the same time.
+ */
+struct Timer {
+  static constexpr std::uint32_t kEnable = 1u << 0;
+  static constexpr std::uint32_t kInterruptEnable = 1u << 3;
+
+  explicit constexpr Timer(std::uintptr_t base)
+      : control(base),
+        value(base + 0x4),
+        reload(base + 0x8),
+        interrupt_clear(base + 0xC) {}
+
+  Register<std::uint32_t> control;
+  Register<std::uint32_t> value;
+  Register<std::uint32_t> reload;
+  Register<std::uint32_t> interrupt_clear;
+};
+
+inline constexpr Timer kTimer0{0x40000000};
+inline constexpr Timer kTimer1{0x40001000};
+
+/**
+ * @brief One of the two counters of the CMSDK dual timer, which share an
+ * interrupt.
+ */
+struct DualTimerChannel {
+  static constexpr std::uint32_t kEnable = 1u << 7;
+  static constexpr std::uint32_t kPeriodic = 1u << 6;
+  static constexpr std::uint32_t kInterruptEnable = 1u << 5;
+  static constexpr std::uint32_t k32Bit = 1u << 1;
+
+  explicit constexpr DualTimerChannel(std::uintptr_t base)
+      : load(base),
+        value(base + 0x4),
+        control(base + 0x8),
+        interrupt_clear(base + 0xC) {}
+
+  Register<std::uint32_t> load;
+  Register<std::uint32_t> value;
+  Register<std::uint32_t> control;
+  Register<std::uint32_t> interrupt_clear;
+};
+
+// Free-running, used as the cycle counter
+inline constexpr DualTimerChannel kDualTimer1{0x40002000};
+inline constexpr DualTimerChannel kDualTimer2{0x40002020};
+
+/**
+ * @brief CMSDK APB UART, connected to the first serial port of QEMU.
+ */
+struct Uart {
+  static constexpr std::uint32_t kTxFull = 1u << 0;
+  static constexpr std::uint32_t kTxEnable = 1u << 0;
+
+  explicit constexpr Uart(std::uintptr_t base)
+      : data(base),
+        state(base + 0x4),
+        control(base + 0x8),
+        baud_divider(base + 0x10) {}
+
+  Register<std::uint32_t> data;
+  Register<std::uint32_t> state;
+  Register<std::uint32_t> control;
+  Register<std::uint32_t> baud_divider;
+};
+
+inline constexpr Uart kUart0{0x40004000};
+
+/**
+ * @brief NVIC registers. armv6-m only allows word accesses to the priority
+ * registers.
+ */
+inline constexpr Register<std::uint32_t> kNvicSetEnable{0xE000E100};
+inline constexpr Register<std::uint32_t> kNvicClearEnable{0xE000E180};
+inline constexpr Register<std::uint32_t> kNvicSetPending{0xE000E200};
+inline constexpr Register<std::uint32_t> kNvicClearPending{0xE000E280};
+
+inline void set_priority(unsigned irq, std::uint32_t priority) {
+  // Only the 2 most significant bits are implemented on every core
+  const Register<std::uint32_t> reg{0xE000E400 + (irq / 4) * 4};
+  const auto shift = (irq % 4) * 8;
+  reg.modify(0xFFu << shift, (priority << 6) << shift);
+}
+
+inline void enable_irq(unsigned irq) { kNvicSetEnable.write(1u << irq); }
+
+inline void disable_irq(unsigned irq) {
+  kNvicClearEnable.write(1u << irq, cortex_m_atomics::mmio::Ordering::kDevice);
+  kNvicClearPending.write(1u << irq);
+}
+
+inline void pend_irq(unsigned irq) { kNvicSetPending.write(1u << irq); }
+
+}  // namespace benchmark
@@ -0,0 +1,556 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Producer/consumer benchmarks of the communication patterns between ISRs
+ * and the thread, built on std::atomic through this library:
+ *
+ * - ISR to thread: a timer ISR publishes timestamps into a BroadcastRing with
+ *   a single consumer, which the thread drains.
+ * - ISRs to thread: three timer ISRs of different priorities, which preempt
+ *   each other, push messages into an MpmcQueue drained by the thread.
+ * - Thread to ISR: the thread pushes commands into an MpmcQueue and pends an
+ *   interrupt whose handler executes them.
+ * - ISR to coroutine and ISR to task: a timer ISR wakes up a coroutine waiting
+ *   on an InterruptEvent, or posts a Task to an Executor, which compares the
+ *   wakeup latency of coroutines with that of run-to-completion callbacks.
+ * - ISR storm: the thread runs read-modify-write operations while a timer
+ *   interrupts it every CORTEX_M_ATOMICS_BENCHMARK_STORM_CYCLES cycles, and
+ *   reports their mean and longest cost. fetch_add takes the bounded
+ *   ldrex/strex path of the runtime dispatch when it is enabled, and
+ *   exclusive_update() is measured when the image is built for a core with
+ *   ldrex/strex.
+ *
+ * Each source sends CORTEX_M_ATOMICS_BENCHMARK_INTERRUPT_HZ messages per
+ * second for CORTEX_M_ATOMICS_BENCHMARK_DURATION_MS. Each benchmark reports
+ * the messages delivered per second, the messages dropped because the queue
+ * was full or the previous wakeup was not handled yet, the longest time from
+ * the interrupt request to its handler, the mean and longest time from
+ * sending a message to its delivery, and the most messages waiting when the
+ * consumer woke up, i.e. the lag of the BroadcastRing consumer. Times are in
+ * cycles of the 25 MHz system clock. With CORTEX_M_ATOMICS_INSTRUMENTATION it also reports the longest
+ * masked section of the library.
+ */
+
+#include <atomic>
+#include <cstdint>
+
+#include "cortex_m_atomics/broadcast_ring.h"
+#include "cortex_m_atomics/coroutine.h"
+#include "cortex_m_atomics/executor.h"
+#if defined(__ARM_FEATURE_LDREX) && (__ARM_FEATURE_LDREX & 4)
+#include "cortex_m_atomics/exclusive.h"
+#endif
+#include "cortex_m_atomics/instrumentation.h"
+#include "cortex_m_atomics/mpmc_queue.h"
+#include "cortex_m_atomics/sleep.h"
+#include "mps2_an385.h"
+#include "startup.h"
+
+namespace benchmark {
+namespace {
+
+using cortex_m_atomics::mmio::Ordering;
+
+constexpr std::uint32_t kInterruptHz = CORTEX_M_ATOMICS_BENCHMARK_INTERRUPT_HZ;
+constexpr std::uint32_t kDurationMs = CORTEX_M_ATOMICS_BENCHMARK_DURATION_MS;
+// Cycles between two messages of a source
+constexpr std::uint32_t kPeriod = kSystemClockHz / kInterruptHz;
+constexpr std::uint32_t kDurationCycles = kSystemClockHz / 1000 * kDurationMs;
+// Cycles between two interrupts of the ISR storm
+constexpr std::uint32_t kStormPeriod = CORTEX_M_ATOMICS_BENCHMARK_STORM_CYCLES;
+static_assert(kPeriod >= 2, "The interrupt rate is above the system clock");
+
+enum class Pattern : std::uint32_t {
+  kIdle,
+  kIsrToThread,
+  kIsrsToThread,
+  kThreadToIsr,
+  kIsrToCoroutine,
+  kIsrToTask,
+  kIsrStorm,
+};
+
+struct Message {
+  std::uint32_t source;
+  // Cycle count when the message was sent
+  std::uint32_t timestamp;
+};
+
+struct Result {
+  std::uint32_t messages;
+  std::uint32_t dropped;
+  std::uint32_t max_interrupt_latency;
+  std::uint32_t mean_delivery_latency;
+  std::uint32_t max_delivery_latency;
+  std::uint32_t max_backlog;
+};
+
+std::atomic<Pattern> g_pattern{Pattern::kIdle};
+// Timestamps sent by a single ISR, read in place by the thread
+cortex_m_atomics::BroadcastRing<std::uint32_t, 64, 1> g_ring;
+// Messages sent by several ISRs to the thread
+cortex_m_atomics::MpmcQueue<Message, 64> g_messages;
+// Commands sent by the thread to command_irq_handler()
+cortex_m_atomics::MpmcQueue<Message, 64> g_commands;
+// Cycle count when the thread last pended the command interrupt
+std::atomic<std::uint32_t> g_command_pended_at{0};
+
+std::atomic<std::uint32_t> g_dropped{0};
+std::atomic<std::uint32_t> g_handled{0};
+std::atomic<std::uint32_t> g_max_interrupt_latency{0};
+std::atomic<std::uint32_t> g_max_delivery_latency{0};
+std::atomic<std::uint64_t> g_total_delivery_latency{0};
+std::atomic<std::uint32_t> g_max_backlog{0};
+
+// Woken up by the timer ISR in the coroutine and task patterns
+cortex_m_atomics::CoroutineExecutor g_coroutines;
+cortex_m_atomics::InterruptEvent g_wakeup{g_coroutines};
+cortex_m_atomics::Executor<1> g_executor;
+void run_task(void*);
+cortex_m_atomics::Task g_task{run_task, nullptr, 0};
+// Set by the ISR and cleared by the woken up code, so that a wakeup sent
+// before the previous one was handled counts as dropped
+std::atomic<bool> g_wakeup_pending{false};
+// Cycle count when the ISR last sent a wakeup
+std::atomic<std::uint32_t> g_wakeup_sent_at{0};
+
+// Updated by the thread and by the ISR of the storm, which also clears the
+// exclusive monitor of the thread every time it is taken
+std::atomic<std::uint32_t> g_storm_counter{0};
+volatile std::uint32_t g_storm_word = 0;
+std::atomic<std::uint32_t> g_storm_interrupts{0};
+
+/**
+ * @brief Returns the number of cycles since the free-running dual timer
+ * channel was started. It counts down, so its value is inverted.
+ */
+auto now() -> std::uint32_t { return ~kDualTimer1.value.read(); }
+
+void record_max(std::atomic<std::uint32_t>& max, std::uint32_t value) {
+  auto current = max.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max.compare_exchange_weak(current, value,
+                                    std::memory_order_relaxed)) {
+  }
+}
+
+/**
+ * @brief Records the delivery of a message sent at a cycle count.
+ */
+void record_delivery(std::uint32_t sent_at) {
+  const auto latency = now() - sent_at;
+  record_max(g_max_delivery_latency, latency);
+  g_total_delivery_latency.fetch_add(latency, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Wakes up the coroutine or posts the task, unless the previous wakeup
+ * has not been handled yet.
+ */
+auto send_wakeup(Pattern pattern) -> bool {
+  if (g_wakeup_pending.exchange(true, std::memory_order_relaxed)) {
+    return false;
+  }
+  g_wakeup_sent_at.store(now(), std::memory_order_relaxed);
+  if (pattern == Pattern::kIsrToCoroutine) {
+    g_wakeup.signal();
+  } else {
+    g_executor.post(g_task);
+  }
+  return true;
+}
+
+/**
+ * @brief Handles a wakeup in the coroutine or in the task.
+ */
+void handle_wakeup() {
+  record_max(g_max_backlog, 1);
+  record_delivery(g_wakeup_sent_at.load(std::memory_order_relaxed));
+  g_handled.fetch_add(1, std::memory_order_relaxed);
+  g_wakeup_pending.store(false, std::memory_order_relaxed);
+}
+
+void run_task(void*) { handle_wakeup(); }
+
+auto wakeup_coroutine() -> cortex_m_atomics::DetachedCoroutine {
+  for (;;) {
+    co_await g_wakeup;
+    handle_wakeup();
+  }
+}
+
+/**
+ * @brief Sends a message from a timer ISR. The message is dropped if the
+ * thread has not drained the previous ones yet.
+ */
+void send(std::uint32_t source) {
+  const auto pattern = g_pattern.load(std::memory_order_relaxed);
+  bool sent;
+  switch (pattern) {
+    case Pattern::kIsrToThread:
+      sent = g_ring.try_publish(now());
+      break;
+    case Pattern::kIsrToCoroutine:
+    case Pattern::kIsrToTask:
+      sent = send_wakeup(pattern);
+      break;
+    default:
+      sent = g_messages.try_push({source, now()});
+      break;
+  }
+  if (!sent) {
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Handles the interrupt of a timer, which requested it when it
+ * reloaded, kPeriod - 1 - value cycles ago.
+ */
+void handle_timer(const Timer& timer, std::uint32_t source) {
+  if (g_pattern.load(std::memory_order_relaxed) == Pattern::kIsrStorm) {
+    timer.interrupt_clear.write(1, Ordering::kDevice);
+    g_storm_counter.fetch_add(1, std::memory_order_relaxed);
+    g_storm_interrupts.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  record_max(g_max_interrupt_latency, kPeriod - 1 - timer.value.read());
+  timer.interrupt_clear.write(1, Ordering::kDevice);
+  send(source);
+}
+
+void handle_dual_timer() {
+  record_max(g_max_interrupt_latency, kPeriod - 1 - kDualTimer2.value.read());
+  kDualTimer2.interrupt_clear.write(1, Ordering::kDevice);
+  send(2);
+}
+
+/**
+ * @brief Executes the commands sent by the thread. A command only records
+ * how long it took to be delivered.
+ */
+void handle_commands() {
+  record_max(g_max_interrupt_latency,
+             now() - g_command_pended_at.load(std::memory_order_relaxed));
+  Message command;
+  std::uint32_t backlog = 0;
+  while (g_commands.try_pop(command)) {
+    record_delivery(command.timestamp);
+    g_handled.fetch_add(1, std::memory_order_relaxed);
+    backlog++;
+  }
+  record_max(g_max_backlog, backlog);
+}
+
+void start_timer(const Timer& timer, unsigned irq, std::uint32_t priority,
+                 std::uint32_t period = kPeriod) {
+  timer.control.write(0);
+  timer.reload.write(period - 1);
+  timer.value.write(period - 1);
+  timer.interrupt_clear.write(1);
+  set_priority(irq, priority);
+  enable_irq(irq);
+  timer.control.write(Timer::kEnable | Timer::kInterruptEnable);
+}
+
+void stop_timer(const Timer& timer, unsigned irq) {
+  timer.control.write(0);
+  disable_irq(irq);
+}
+
+void reset(Pattern pattern) {
+  g_dropped.store(0, std::memory_order_relaxed);
+  g_handled.store(0, std::memory_order_relaxed);
+  g_max_interrupt_latency.store(0, std::memory_order_relaxed);
+  g_max_delivery_latency.store(0, std::memory_order_relaxed);
+  g_total_delivery_latency.store(0, std::memory_order_relaxed);
+  g_max_backlog.store(0, std::memory_order_relaxed);
+#if defined(CORTEX_M_ATOMICS_INSTRUMENTATION)
+  cortex_m_atomics::reset_statistics();
+#endif
+  g_pattern.store(pattern, std::memory_order_release);
+}
+
+auto finish(std::uint32_t messages) -> Result {
+  g_pattern.store(Pattern::kIdle, std::memory_order_relaxed);
+  const auto total = g_total_delivery_latency.load(std::memory_order_relaxed);
+  return {messages, g_dropped.load(std::memory_order_relaxed),
+          g_max_interrupt_latency.load(std::memory_order_relaxed),
+          static_cast<std::uint32_t>(messages == 0 ? 0 : total / messages),
+          g_max_delivery_latency.load(std::memory_order_relaxed),
+          g_max_backlog.load(std::memory_order_relaxed)};
+}
+
+auto isr_to_thread() -> Result {
+  reset(Pattern::kIsrToThread);
+  std::uint32_t messages = 0;
+  const auto start = now();
+  start_timer(kTimer0, kTimer0Irq, 0);
+  while (now() - start < kDurationCycles) {
+    cortex_m_atomics::sleep_until([]() { return g_ring.lag(0) != 0; });
+    record_max(g_max_backlog, g_ring.lag(0));
+    while (const auto* timestamp = g_ring.peek(0)) {
+      record_delivery(*timestamp);
+      g_ring.release(0);
+      messages++;
+    }
+  }
+  stop_timer(kTimer0, kTimer0Irq);
+  return finish(messages);
+}
+
+auto isrs_to_thread() -> Result {
+  reset(Pattern::kIsrsToThread);
+  std::uint32_t messages = 0;
+  const auto start = now();
+  start_timer(kTimer0, kTimer0Irq, 2);
+  start_timer(kTimer1, kTimer1Irq, 1);
+  kDualTimer2.load.write(kPeriod - 1);
+  kDualTimer2.interrupt_clear.write(1);
+  set_priority(kDualTimerIrq, 0);
+  enable_irq(kDualTimerIrq);
+  kDualTimer2.control.write(
+      DualTimerChannel::kEnable | DualTimerChannel::kPeriodic |
+      DualTimerChannel::kInterruptEnable | DualTimerChannel::k32Bit);
+
+  while (now() - start < kDurationCycles) {
+    Message message;
+    cortex_m_atomics::sleep_until(
+        [&]() { return g_messages.try_pop(message); });
+    std::uint32_t backlog = 0;
+    do {
+      record_delivery(message.timestamp);
+      messages++;
+      backlog++;
+    } while (g_messages.try_pop(message));
+    record_max(g_max_backlog, backlog);
+  }
+
+  stop_timer(kTimer0, kTimer0Irq);
+  stop_timer(kTimer1, kTimer1Irq);
+  kDualTimer2.control.write(0);
+  disable_irq(kDualTimerIrq);
+  return finish(messages);
+}
+
+auto thread_to_isr() -> Result {
+  reset(Pattern::kThreadToIsr);
+  set_priority(kCommandIrq, 0);
+  enable_irq(kCommandIrq);
+  const auto start = now();
+  auto next = start;
+  while (now() - start < kDurationCycles) {
+    // Busy waits, so that the commands are sent at the interrupt rate
+    if (static_cast<std::int32_t>(now() - next) < 0) {
+      continue;
+    }
+    next += kPeriod;
+    if (g_commands.try_push({0, now()})) {
+      g_command_pended_at.store(now(), std::memory_order_relaxed);
+      pend_irq(kCommandIrq);
+    } else {
+      g_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  disable_irq(kCommandIrq);
+  return finish(g_handled.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Wakes up the coroutine or the task from a timer ISR. The thread runs
+ * whichever is ready, and sleeps until the next wakeup otherwise.
+ */
+auto isr_to_wakeup(Pattern pattern) -> Result {
+  reset(pattern);
+  const auto start = now();
+  start_timer(kTimer0, kTimer0Irq, 0);
+  while (now() - start < kDurationCycles) {
+    const bool ran = pattern == Pattern::kIsrToCoroutine
+                         ? g_coroutines.run_ready()
+                         : g_executor.run_once();
+    if (!ran) {
+      cortex_m_atomics::sleep_until([]() {
+        return g_wakeup_pending.load(std::memory_order_relaxed);
+      });
+    }
+  }
+  stop_timer(kTimer0, kTimer0Irq);
+  // Handles the last wakeup, if any, so that the next pattern starts idle
+  while (g_coroutines.run_ready() || g_executor.run_once()) {
+  }
+  return finish(g_handled.load(std::memory_order_relaxed));
+}
+
+struct StormResult {
+  std::uint32_t operations;
+  std::uint32_t interrupts;
+  std::uint32_t mean_cycles;
+  std::uint32_t max_cycles;
+};
+
+/**
+ * @brief Runs a read-modify-write operation back to back for the duration of
+ * the benchmark while the storm interrupts it, timing each one. The times
+ * include reading the timer, which is the same for every operation.
+ */
+template <class Operation>
+auto isr_storm(Operation operation) -> StormResult {
+  reset(Pattern::kIsrStorm);
+  g_storm_interrupts.store(0, std::memory_order_relaxed);
+  std::uint32_t operations = 0;
+  std::uint64_t total = 0;
+  std::uint32_t max = 0;
+  const auto start = now();
+  start_timer(kTimer0, kTimer0Irq, 0, kStormPeriod);
+  while (now() - start < kDurationCycles) {
+    const auto begin = now();
+    operation();
+    const auto cycles = now() - begin;
+    total += cycles;
+    max = cycles > max ? cycles : max;
+    operations++;
+  }
+  stop_timer(kTimer0, kTimer0Irq);
+  g_pattern.store(Pattern::kIdle, std::memory_order_relaxed);
+  return {operations, g_storm_interrupts.load(std::memory_order_relaxed),
+          static_cast<std::uint32_t>(total / operations), max};
+}
+
+void print(char character) {
+  while ((kUart0.state.read() & Uart::kTxFull) != 0) {
+  }
+  kUart0.data.write(static_cast<std::uint8_t>(character));
+}
+
+void print(const char* text) {
+  for (; *text != '\0'; text++) {
+    print(*text);
+  }
+}
+
+void print(std::uint32_t value) {
+  char digits[10];
+  unsigned num_digits = 0;
+  do {
+    digits[num_digits++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (num_digits != 0) {
+    print(digits[--num_digits]);
+  }
+}
+
+void report(const char* name, const Result& result) {
+  print(name);
+  print(": ");
+  print(static_cast<std::uint32_t>(
+      static_cast<std::uint64_t>(result.messages) * 1000 / kDurationMs));
+  print(" messages/s, ");
+  print(result.dropped);
+  print(" dropped, max interrupt latency ");
+  print(result.max_interrupt_latency);
+  print(", mean delivery latency ");
+  print(result.mean_delivery_latency);
+  print(", max delivery latency ");
+  print(result.max_delivery_latency);
+  print(", max backlog ");
+  print(result.max_backlog);
+#if defined(CORTEX_M_ATOMICS_INSTRUMENTATION)
+  print(", max masked section ");
+  print(cortex_m_atomics::statistics().max_masked_cycles);
+#endif
+  print("\n");
+}
+
+void report(const char* name, const StormResult& result) {
+  print(name);
+  print(": ");
+  print(result.operations);
+  print(" operations under ");
+  print(result.interrupts);
+  print(" interrupts, mean ");
+  print(result.mean_cycles);
+  print(" cycles, max ");
+  print(result.max_cycles);
+#if defined(CORTEX_M_ATOMICS_INSTRUMENTATION)
+  const auto statistics = cortex_m_atomics::statistics();
+  print(", exclusive retries ");
+  print(statistics.exclusive_retries);
+  print(", fallbacks ");
+  print(statistics.exclusive_fallbacks);
+  print(", max masked section ");
+  print(statistics.max_masked_cycles);
+#endif
+  print("\n");
+}
+
+}  // namespace
+
+auto run() -> int {
+  kUart0.baud_divider.write(16);
+  kUart0.control.write(Uart::kTxEnable);
+  kDualTimer1.load.write(0xFFFFFFFF);
+  kDualTimer1.control.write(DualTimerChannel::kEnable |
+                            DualTimerChannel::k32Bit);
+
+  print("Producer/consumer benchmarks, ");
+  print(kInterruptHz);
+  print(" messages/s per source, latencies in cycles\n");
+  report("ISR to thread", isr_to_thread());
+  report("3 ISRs to thread", isrs_to_thread());
+  report("Thread to ISR", thread_to_isr());
+  // Started once, the coroutine waits for its first wakeup
+  wakeup_coroutine();
+  report("ISR to coroutine", isr_to_wakeup(Pattern::kIsrToCoroutine));
+  report("ISR to task", isr_to_wakeup(Pattern::kIsrToTask));
+  report("ISR storm, fetch_add", isr_storm([]() {
+           g_storm_counter.fetch_add(1, std::memory_order_relaxed);
+         }));
+#if defined(__ARM_FEATURE_LDREX) && (__ARM_FEATURE_LDREX & 4)
+  report("ISR storm, exclusive_update", isr_storm([]() {
+           cortex_m_atomics::exclusive_update(
+               &g_storm_word, [](std::uint32_t word) { return word + 1; });
+         }));
+#endif
+  return 0;
+}
+
+}  // namespace benchmark
+
+extern "C" auto cortex_m_atomics_cycle_counter() -> std::uint32_t {
+  return benchmark::now();
+}
+
+extern "C" void timer0_irq_handler() {
+  benchmark::handle_timer(benchmark::kTimer0, 0);
+}
+
+extern "C" void timer1_irq_handler() {
+  benchmark::handle_timer(benchmark::kTimer1, 1);
+}
+
+extern "C" void dual_timer_irq_handler() { benchmark::handle_dual_timer(); }
+
+extern "C" void command_irq_handler() { benchmark::handle_commands(); }
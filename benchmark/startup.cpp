@@ -0,0 +1,158 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Vector table and reset handler of the benchmarks for the mps2-an385 machine
+ * of QEMU.
+ */
+
+#include <cstdint>
+
+#include "mps2_an385.h"
+#include "startup.h"
+
+extern "C" {
+
+// Defined by mps2_an385.ld
+extern std::uint32_t __data_load_start[];
+extern std::uint32_t __data_start[];
+extern std::uint32_t __data_end[];
+extern std::uint32_t __bss_start[];
+extern std::uint32_t __bss_end[];
+extern std::uint32_t __stack_top[];
+extern void (*__init_array_start[])();
+extern void (*__init_array_end[])();
+
+void default_handler() {
+  for (;;) {
+  }
+}
+
+void timer0_irq_handler() __attribute__((weak, alias("default_handler")));
+void timer1_irq_handler() __attribute__((weak, alias("default_handler")));
+void dual_timer_irq_handler() __attribute__((weak, alias("default_handler")));
+void command_irq_handler() __attribute__((weak, alias("default_handler")));
+
+[[noreturn]] void reset_handler();
+
+}  // extern "C"
+
+namespace {
+
+/**
+ * @brief Stops QEMU through the semihosting SYS_EXIT call, reporting whether
+ * the benchmark succeeded. QEMU must be started with -semihosting.
+ */
+[[noreturn]] void exit_qemu(int code) {
+  constexpr std::uint32_t kSysExit = 0x18;
+  constexpr std::uint32_t kApplicationExit = 0x20026;
+  constexpr std::uint32_t kRunTimeErrorUnknown = 0x20023;
+  const std::uint32_t reason =
+      code == 0 ? kApplicationExit : kRunTimeErrorUnknown;
+  asm volatile(
+      "mov r0, %0\n\t"
+      "mov r1, %1\n\t"
+      "bkpt 0xab"
+      :
+      : "r"(kSysExit), "r"(reason)
+      : "r0", "r1", "memory");
+  for (;;) {
+  }
+}
+
+union Vector {
+  std::uint32_t* stack;
+  void (*handler)();
+};
+
+constexpr unsigned kNumExceptions = 16;
+
+}  // namespace
+
+__attribute__((section(".isr_vector"), used)) extern const Vector
+    kVectorTable[kNumExceptions + benchmark::kNumIrqs] = {
+    {.stack = __stack_top},
+    {.handler = reset_handler},
+    {.handler = default_handler},  // NMI
+    {.handler = default_handler},  // HardFault
+    {.handler = default_handler},  // MemManage
+    {.handler = default_handler},  // BusFault
+    {.handler = default_handler},  // UsageFault
+    {.handler = nullptr},
+    {.handler = nullptr},
+    {.handler = nullptr},
+    {.handler = nullptr},
+    {.handler = default_handler},  // SVCall
+    {.handler = default_handler},  // DebugMonitor
+    {.handler = nullptr},
+    {.handler = default_handler},  // PendSV
+    {.handler = default_handler},  // SysTick
+    {.handler = default_handler},  // IRQ 0
+    {.handler = default_handler},  // IRQ 1
+    {.handler = default_handler},  // IRQ 2
+    {.handler = default_handler},  // IRQ 3
+    {.handler = default_handler},  // IRQ 4
+    {.handler = default_handler},  // IRQ 5
+    {.handler = default_handler},  // IRQ 6
+    {.handler = default_handler},  // IRQ 7
+    {.handler = timer0_irq_handler},  // IRQ 8
+    {.handler = timer1_irq_handler},  // IRQ 9
+    {.handler = dual_timer_irq_handler},  // IRQ 10
+    {.handler = default_handler},  // IRQ 11
+    {.handler = default_handler},  // IRQ 12
+    {.handler = default_handler},  // IRQ 13
+    {.handler = default_handler},  // IRQ 14
+    {.handler = default_handler},  // IRQ 15
+    {.handler = default_handler},  // IRQ 16
+    {.handler = default_handler},  // IRQ 17
+    {.handler = default_handler},  // IRQ 18
+    {.handler = default_handler},  // IRQ 19
+    {.handler = default_handler},  // IRQ 20
+    {.handler = default_handler},  // IRQ 21
+    {.handler = default_handler},  // IRQ 22
+    {.handler = default_handler},  // IRQ 23
+    {.handler = default_handler},  // IRQ 24
+    {.handler = default_handler},  // IRQ 25
+    {.handler = default_handler},  // IRQ 26
+    {.handler = default_handler},  // IRQ 27
+    {.handler = default_handler},  // IRQ 28
+    {.handler = default_handler},  // IRQ 29
+    {.handler = default_handler},  // IRQ 30
+    {.handler = command_irq_handler},  // IRQ 31
+};
+
+extern "C" void reset_handler() {
+  const std::uint32_t* source = __data_load_start;
+  for (std::uint32_t* word = __data_start; word != __data_end; word++) {
+    *word = *source++;
+  }
+  for (std::uint32_t* word = __bss_start; word != __bss_end; word++) {
+    *word = 0;
+  }
+  for (auto* constructor = __init_array_start;
+       constructor != __init_array_end; constructor++) {
+    (*constructor)();
+  }
+  exit_qemu(benchmark::run());
+}
@@ -0,0 +1,51 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Interface between the startup code of the benchmarks in startup.cpp and the
+ * benchmark linked with it.
+ */
+
+extern "C" {
+
+// Handlers of the interrupts used by the benchmarks. The benchmark defines the
+// ones it uses, the others stop in the default handler
+void timer0_irq_handler();
+void timer1_irq_handler();
+void dual_timer_irq_handler();
+void command_irq_handler();
+
+}  // extern "C"
+
+namespace benchmark {
+
+/**
+ * @brief Runs the benchmark. Called by the reset handler once memory is
+ * initialised, and its return value becomes the exit code of QEMU.
+ */
+auto run() -> int;
+
+}  // namespace benchmark
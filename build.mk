@@ -22,7 +22,14 @@ LOCAL_CXXFLAGS := \
     -fno-exceptions \
     -fno-rtti
 LOCAL_SRC := \
-    $(LOCAL_DIR)/src/atomic.cpp
+    $(LOCAL_DIR)/src/atomic.cpp \
+    $(LOCAL_DIR)/src/atomic_bulk.cpp \
+    $(LOCAL_DIR)/src/atomic_memcpy.cpp \
+    $(LOCAL_DIR)/src/dispatch.cpp \
+    $(LOCAL_DIR)/src/instrumentation.cpp \
+    $(LOCAL_DIR)/src/multicore.cpp \
+    $(LOCAL_DIR)/src/newlib_lock.cpp \
+    $(LOCAL_DIR)/src/secure_gateway.cpp
 LOCAL_ARM_ARCHITECTURE := v6-m
 LOCAL_ARM_FPU := nofp
 LOCAL_COMPILER := arm_clang
@@ -0,0 +1,267 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CORTEX_M_ATOMICS_ATOMIC_H
+#define CORTEX_M_ATOMICS_ATOMIC_H
+
+/*
+ * Inline atomics for C code, equivalent to the intrinsics in src/atomic.cpp.
+ *
+ * Operations on `_Atomic` objects from <stdatomic.h> become out-of-line calls
+ * to the __atomic_*_N intrinsics with a runtime order argument. The macros in
+ * this header are inlined instead, so a constant order removes the barriers
+ * that are not needed:
+ *
+ *   _Atomic uint32_t counter;
+ *   cma_atomic_fetch_add(&counter, 1, memory_order_relaxed);
+ *
+ * They accept pointers to integer objects, `_Atomic` or not, and select the
+ * implementation for their size with _Generic. Atomic pointers can be stored
+ * as `atomic_uintptr_t`. Objects must be naturally aligned, as `_Atomic`
+ * objects always are.
+ *
+ * The inline read-modify-write operations always mask interrupts, even if the
+ * library is built with runtime dispatch. With CORTEX_M_ATOMICS_MULTICORE they
+ * also take the spinlock shared by the cores, as the intrinsics do, and so do
+ * the stores.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+/* Defined in src/multicore.cpp, see cortex_m_atomics/multicore.h */
+void cortex_m_atomics_multicore_lock(void);
+void cortex_m_atomics_multicore_unlock(void);
+#define CMA_MULTICORE true
+#else
+#define CMA_MULTICORE false
+#endif
+
+static inline uint32_t cma_disable_interrupts(void) {
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask" : "=r"(primask));
+  if (primask == 0) {
+    __asm__ volatile("cpsid i" : : : "memory");
+  }
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  cortex_m_atomics_multicore_lock();
+#endif
+  return primask;
+}
+
+/* Reenables interrupts only if cma_disable_interrupts() disabled them */
+static inline void cma_restore_interrupts(uint32_t primask) {
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  cortex_m_atomics_multicore_unlock();
+#endif
+  if (primask == 0) {
+    __asm__ volatile("cpsie i" : : : "memory");
+  }
+}
+
+static inline void cma_memory_barrier(void) {
+  __asm__ volatile("dmb" : : : "memory");
+}
+
+/* Barrier before a store, same as atomic_store<T> */
+static inline void cma_store_barrier_before(int order) {
+  if (order != __ATOMIC_RELAXED) {
+    cma_memory_barrier();
+  }
+}
+
+/* Barrier after a store, same as atomic_store<T> */
+static inline void cma_store_barrier_after(int order) {
+  if (order == __ATOMIC_SEQ_CST || order == __ATOMIC_ACQ_REL ||
+      order == __ATOMIC_ACQUIRE) {
+    cma_memory_barrier();
+  }
+}
+
+/* Barrier before a load, same as atomic_load<T> */
+static inline void cma_load_barrier_before(int order) {
+  if (order == __ATOMIC_SEQ_CST || order == __ATOMIC_ACQ_REL ||
+      order == __ATOMIC_RELEASE) {
+    cma_memory_barrier();
+  }
+}
+
+/* Barrier after a load, same as atomic_load<T> */
+static inline void cma_load_barrier_after(int order) {
+  if (order != __ATOMIC_RELAXED) {
+    cma_memory_barrier();
+  }
+}
+
+/* Barrier around read-modify-write operations */
+static inline void cma_rmw_barrier(int order) {
+  if (order != __ATOMIC_RELAXED) {
+    cma_memory_barrier();
+  }
+}
+
+/*
+ * Defines the operations on values of the given size. 64 bit loads and stores
+ * need two instructions, so they mask interrupts as well. On multi-core parts
+ * every store does, so that it cannot land in the middle of a read-modify-write
+ * operation of another core.
+ */
+#define CMA_DEFINE_ATOMICS(size, type, masked_access)                        \
+  static inline type cma_atomic_load_##size(const volatile void* ptr,        \
+                                            int order) {                     \
+    cma_load_barrier_before(order);                                          \
+    const uint32_t primask = masked_access ? cma_disable_interrupts() : 1;   \
+    const type value = *(const volatile type*)ptr;                           \
+    if (masked_access) {                                                     \
+      cma_restore_interrupts(primask);                                       \
+    }                                                                        \
+    cma_load_barrier_after(order);                                           \
+    return value;                                                            \
+  }                                                                          \
+                                                                             \
+  static inline void cma_atomic_store_##size(volatile void* ptr, type value, \
+                                             int order) {                    \
+    cma_store_barrier_before(order);                                         \
+    const bool masked_store = masked_access || CMA_MULTICORE;                \
+    const uint32_t primask = masked_store ? cma_disable_interrupts() : 1;    \
+    *(volatile type*)ptr = value;                                            \
+    if (masked_store) {                                                      \
+      cma_restore_interrupts(primask);                                       \
+    }                                                                        \
+    cma_store_barrier_after(order);                                          \
+  }                                                                          \
+                                                                             \
+  static inline type cma_atomic_exchange_##size(volatile void* ptr,          \
+                                                type value, int order) {     \
+    const uint32_t primask = cma_disable_interrupts();                       \
+    cma_rmw_barrier(order);                                                  \
+    const type prev_value = *(volatile type*)ptr;                            \
+    *(volatile type*)ptr = value;                                            \
+    cma_rmw_barrier(order);                                                  \
+    cma_restore_interrupts(primask);                                         \
+    return prev_value;                                                       \
+  }                                                                          \
+                                                                             \
+  static inline bool cma_atomic_compare_exchange_##size(                     \
+      volatile void* ptr, void* expected, type desired, int success,         \
+      int failure) {                                                         \
+    const uint32_t primask = cma_disable_interrupts();                       \
+    cma_rmw_barrier(success);                                                \
+    const type current_value = *(volatile type*)ptr;                         \
+    const bool equal = current_value == *(type*)expected;                    \
+    if (equal) {                                                             \
+      *(volatile type*)ptr = desired;                                        \
+    } else {                                                                 \
+      *(type*)expected = current_value;                                      \
+    }                                                                        \
+    cma_rmw_barrier(equal ? success : failure);                              \
+    cma_restore_interrupts(primask);                                         \
+    return equal;                                                            \
+  }                                                                          \
+                                                                             \
+  CMA_DEFINE_FETCH_OP(size, type, add, +)                                    \
+  CMA_DEFINE_FETCH_OP(size, type, sub, -)                                    \
+  CMA_DEFINE_FETCH_OP(size, type, and, &)                                    \
+  CMA_DEFINE_FETCH_OP(size, type, or, |)                                     \
+  CMA_DEFINE_FETCH_OP(size, type, xor, ^)
+
+#define CMA_DEFINE_FETCH_OP(size, type, name, op)       \
+  static inline type cma_atomic_fetch_##name##_##size(  \
+      volatile void* ptr, type value, int order) {      \
+    const uint32_t primask = cma_disable_interrupts();  \
+    cma_rmw_barrier(order);                             \
+    const type prev_value = *(volatile type*)ptr;       \
+    *(volatile type*)ptr = (type)(prev_value op value); \
+    cma_rmw_barrier(order);                             \
+    cma_restore_interrupts(primask);                    \
+    return prev_value;                                  \
+  }
+
+CMA_DEFINE_ATOMICS(1, uint8_t, false)
+CMA_DEFINE_ATOMICS(2, uint16_t, false)
+CMA_DEFINE_ATOMICS(4, uint32_t, false)
+CMA_DEFINE_ATOMICS(8, uint64_t, true)
+
+#undef CMA_DEFINE_FETCH_OP
+#undef CMA_DEFINE_ATOMICS
+#undef CMA_MULTICORE
+
+#if __SIZEOF_LONG__ == 8
+#define CMA_GENERIC_LONG(name) name##_8
+#else
+#define CMA_GENERIC_LONG(name) name##_4
+#endif
+
+/* Selects the implementation of an operation for the size of *(obj) */
+#define CMA_GENERIC(name, obj)               \
+  _Generic(*(obj),                           \
+      _Bool: name##_1,                       \
+      char: name##_1,                        \
+      signed char: name##_1,                 \
+      unsigned char: name##_1,               \
+      short: name##_2,                       \
+      unsigned short: name##_2,              \
+      int: name##_4,                         \
+      unsigned int: name##_4,                \
+      long: CMA_GENERIC_LONG(name),          \
+      unsigned long: CMA_GENERIC_LONG(name), \
+      long long: name##_8,                   \
+      unsigned long long: name##_8)
+
+#define cma_atomic_load(obj, order) \
+  CMA_GENERIC(cma_atomic_load, obj)((const volatile void*)(obj), (order))
+
+#define cma_atomic_store(obj, value, order) \
+  CMA_GENERIC(cma_atomic_store, obj)((volatile void*)(obj), (value), (order))
+
+#define cma_atomic_exchange(obj, value, order)                          \
+  CMA_GENERIC(cma_atomic_exchange, obj)((volatile void*)(obj), (value), \
+                                        (order))
+
+#define cma_atomic_compare_exchange(obj, expected, desired, success, failure) \
+  CMA_GENERIC(cma_atomic_compare_exchange, obj)(                              \
+      (volatile void*)(obj), (expected), (desired), (success), (failure))
+
+#define cma_atomic_fetch_add(obj, value, order)                          \
+  CMA_GENERIC(cma_atomic_fetch_add, obj)((volatile void*)(obj), (value), \
+                                         (order))
+
+#define cma_atomic_fetch_sub(obj, value, order)                          \
+  CMA_GENERIC(cma_atomic_fetch_sub, obj)((volatile void*)(obj), (value), \
+                                         (order))
+
+#define cma_atomic_fetch_and(obj, value, order)                          \
+  CMA_GENERIC(cma_atomic_fetch_and, obj)((volatile void*)(obj), (value), \
+                                         (order))
+
+#define cma_atomic_fetch_or(obj, value, order)                          \
+  CMA_GENERIC(cma_atomic_fetch_or, obj)((volatile void*)(obj), (value), \
+                                        (order))
+
+#define cma_atomic_fetch_xor(obj, value, order)                          \
+  CMA_GENERIC(cma_atomic_fetch_xor, obj)((volatile void*)(obj), (value), \
+                                         (order))
+
+#endif /* CORTEX_M_ATOMICS_ATOMIC_H */
@@ -0,0 +1,149 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Single-producer ring whose entries are read by every consumer, in the
+ * style of the LMAX Disruptor.
+ *
+ * The producer writes each entry in place and publishes it with a release
+ * store of the cursor. Each consumer owns a sequence with the number of
+ * entries it has released, so an entry is written once and read in place by
+ * all of them. The producer only waits for the slowest consumer, and keeps a
+ * cached copy of its sequence so that it does not read every sequence for
+ * each entry.
+ *
+ * The producer side must be used from a single context. Each consumer must
+ * only be used from one context at a time, but different consumers may run in
+ * different contexts.
+ */
+template <class T, std::size_t kCapacity, std::size_t kNumConsumers>
+class BroadcastRing {
+  static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two");
+  static_assert(kNumConsumers > 0, "The ring needs at least one consumer");
+
+ public:
+  /**
+   * @brief Returns the entry to write next, or nullptr if the slowest consumer
+   * has not released the entry that used it a lap ago. The entry becomes
+   * visible with publish().
+   */
+  auto try_claim() -> T* {
+    const auto cursor = cursor_.load(std::memory_order_relaxed);
+    if (cursor - gating_sequence_ >= kCapacity) {
+      gating_sequence_ = slowest_sequence(cursor);
+      if (cursor - gating_sequence_ >= kCapacity) {
+        return nullptr;
+      }
+    }
+    return &entries_[cursor & kIndexMask];
+  }
+
+  /**
+   * @brief Makes the entry returned by try_claim() visible to the consumers.
+   */
+  void publish() {
+    cursor_.store(cursor_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+  }
+
+  /**
+   * @brief Copies a value into the next entry and publishes it. Returns false
+   * if the ring is full.
+   */
+  auto try_publish(const T& value) -> bool {
+    T* entry = try_claim();
+    if (entry == nullptr) {
+      return false;
+    }
+    *entry = value;
+    publish();
+    return true;
+  }
+
+  /**
+   * @brief Returns the next entry a consumer has not released, or nullptr if
+   * it has read every published entry. The entry stays valid until the
+   * consumer releases it.
+   */
+  auto peek(std::size_t consumer) const -> const T* {
+    const auto sequence =
+        sequences_[consumer].load(std::memory_order_relaxed);
+    if (cursor_.load(std::memory_order_acquire) == sequence) {
+      return nullptr;
+    }
+    return &entries_[sequence & kIndexMask];
+  }
+
+  /**
+   * @brief Releases the entry returned by peek(), so that the producer can
+   * reuse it once every other consumer has released it too.
+   */
+  void release(std::size_t consumer) {
+    auto& sequence = sequences_[consumer];
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+  }
+
+  /**
+   * @brief Returns how many published entries a consumer has not released.
+   */
+  auto lag(std::size_t consumer) const -> std::uint32_t {
+    return cursor_.load(std::memory_order_acquire) -
+           sequences_[consumer].load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr std::uint32_t kIndexMask = kCapacity - 1;
+
+  auto slowest_sequence(std::uint32_t cursor) const -> std::uint32_t {
+    std::uint32_t max_lag = 0;
+    for (const auto& sequence : sequences_) {
+      // Acquire, so that the consumer is done reading the entry before it is
+      // written again
+      const auto lag = cursor - sequence.load(std::memory_order_acquire);
+      if (lag > max_lag) {
+        max_lag = lag;
+      }
+    }
+    return cursor - max_lag;
+  }
+
+  std::array<T, kCapacity> entries_{};
+  std::atomic<std::uint32_t> cursor_{0};
+  std::array<std::atomic<std::uint32_t>, kNumConsumers> sequences_{};
+  // Only accessed by the producer
+  std::uint32_t gating_sequence_ = 0;
+};
+
+}  // namespace cortex_m_atomics
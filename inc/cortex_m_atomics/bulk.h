@@ -0,0 +1,49 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Copies count counters into snapshot and resets them to 0. Each
+ * counter is read and reset atomically, so no increment is lost, but the array
+ * is only consistent within a chunk of CORTEX_M_ATOMICS_BULK_CHUNK_SIZE
+ * counters. Interrupts are masked once per chunk, which bounds the interrupt
+ * latency regardless of count.
+ */
+void atomic_snapshot_and_reset(std::uint32_t* counters,
+                               std::uint32_t* snapshot, std::size_t count);
+
+/**
+ * @brief Atomically adds values[i] to counters[i] for count counters, masking
+ * interrupts once per chunk, as in atomic_snapshot_and_reset().
+ */
+void atomic_add_array(std::uint32_t* counters, const std::uint32_t* values,
+                      std::size_t count);
+
+}  // namespace cortex_m_atomics
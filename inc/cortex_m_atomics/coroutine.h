@@ -0,0 +1,192 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#if __cplusplus < 202002L || !__has_include(<coroutine>)
+#error "cortex_m_atomics/coroutine.h requires C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+
+#include "cortex_m_atomics/intrusive_lifo.h"
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Node of the list of coroutines ready to be resumed. It lives in the
+ * frame of the suspended coroutine, so no memory is allocated to schedule it.
+ */
+struct ReadyNode {
+  ReadyNode* next = nullptr;
+  std::coroutine_handle<> handle;
+};
+
+/**
+ * @brief Resumes coroutines made ready by ISRs from the main loop.
+ *
+ * ISRs push the coroutines onto an IntrusiveLifo. The main loop takes the whole
+ * list with a single exchange and resumes the coroutines in the order they
+ * became ready. run_ready() must only be called from thread mode, never from
+ * an ISR.
+ */
+class CoroutineExecutor {
+ public:
+  /**
+   * @brief Makes a coroutine ready to run. Can be called from any context.
+   */
+  void schedule(ReadyNode& node) { ready_.push(node); }
+
+  /**
+   * @brief Resumes every coroutine that is ready. Returns false if there was
+   * none, so that the caller can go to sleep.
+   */
+  auto run_ready() -> bool {
+    ReadyNode* ready = ready_.take_all();
+    if (ready == nullptr) {
+      return false;
+    }
+
+    while (ready != nullptr) {
+      // The node lives in the coroutine frame, so it cannot be accessed after
+      // the coroutine is resumed
+      ReadyNode* next = ready->next;
+      ready->handle.resume();
+      ready = next;
+    }
+    return true;
+  }
+
+ private:
+  IntrusiveLifo<ReadyNode> ready_;
+};
+
+/**
+ * @brief An event signaled by an ISR that a coroutine can co_await.
+ *
+ * The ISR signals the event with a single compare exchange, and if a
+ * coroutine is waiting on it, schedules the coroutine in the executor. Waking
+ * the coroutine consumes the signal, so one that happens after the coroutine
+ * is scheduled is remembered for its next co_await. Signals that happen while
+ * nobody waits are remembered, but they are not counted. Only one coroutine
+ * may wait on an event at a time.
+ */
+class InterruptEvent {
+  static constexpr std::uintptr_t kIdle = 0;
+  static constexpr std::uintptr_t kSignaled = 1;
+
+ public:
+  class Awaiter {
+   public:
+    explicit Awaiter(InterruptEvent& event) : event_(event) {}
+
+    auto await_ready() const noexcept -> bool {
+      // Consumes a signal that happened while nobody waited. The load keeps
+      // the read-modify-write off the common path
+      if (event_.state_.load(std::memory_order_relaxed) != kSignaled) {
+        return false;
+      }
+      std::uintptr_t expected = kSignaled;
+      return event_.state_.compare_exchange_strong(
+          expected, kIdle, std::memory_order_acquire,
+          std::memory_order_relaxed);
+    }
+
+    auto await_suspend(std::coroutine_handle<> handle) noexcept -> bool {
+      node_.handle = handle;
+      // Fails if the event was signaled after await_ready(), in which case
+      // the coroutine consumes the signal and continues without suspending.
+      // Only signal() changes the state meanwhile, and it leaves kSignaled
+      std::uintptr_t expected = kIdle;
+      if (event_.state_.compare_exchange_strong(
+              expected, reinterpret_cast<std::uintptr_t>(&node_),
+              std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return true;
+      }
+      event_.state_.store(kIdle, std::memory_order_relaxed);
+      return false;
+    }
+
+    // The signal was consumed by signal() or by the awaiter itself
+    void await_resume() noexcept {}
+
+   private:
+    InterruptEvent& event_;
+    ReadyNode node_;
+  };
+
+  explicit InterruptEvent(CoroutineExecutor& executor) : executor_(executor) {}
+
+  InterruptEvent(const InterruptEvent&) = delete;
+  auto operator=(const InterruptEvent&) -> InterruptEvent& = delete;
+
+  /**
+   * @brief Signals the event. Meant to be called from the ISR. Waking a
+   * coroutine takes a second read-modify-write to push it onto the ready list
+   * of the executor.
+   */
+  void signal() {
+    auto state = state_.load(std::memory_order_relaxed);
+    std::uintptr_t new_state;
+    do {
+      // Waking the waiting coroutine consumes the signal
+      new_state = is_waiting(state) ? kIdle : kSignaled;
+    } while (!state_.compare_exchange_weak(state, new_state,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed));
+    if (is_waiting(state)) {
+      executor_.schedule(*reinterpret_cast<ReadyNode*>(state));
+    }
+  }
+
+  auto operator co_await() -> Awaiter { return Awaiter{*this}; }
+
+ private:
+  static auto is_waiting(std::uintptr_t state) -> bool {
+    return state != kIdle && state != kSignaled;
+  }
+
+  CoroutineExecutor& executor_;
+  // kIdle, kSignaled or the address of the ReadyNode of the waiting coroutine
+  std::atomic<std::uintptr_t> state_{kIdle};
+};
+
+/**
+ * @brief Return type for driver coroutines that are started eagerly and never
+ * awaited. The frame is destroyed when the coroutine finishes.
+ */
+struct DetachedCoroutine {
+  struct promise_type {
+    auto get_return_object() noexcept -> DetachedCoroutine { return {}; }
+    auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+    auto final_suspend() noexcept -> std::suspend_never { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+}  // namespace cortex_m_atomics
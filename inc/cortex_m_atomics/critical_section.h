@@ -0,0 +1,200 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "cortex_m_atomics/instrumentation.h"
+#include "cortex_m_atomics/multicore.h"
+
+#if defined(CORTEX_M_ATOMICS_HOST)
+#include "cortex_m_atomics/host.h"
+#endif
+
+namespace cortex_m_atomics {
+
+// Type traits that check if an action returns void
+template <class Action, class... Args>
+using returns_void = std::is_void<std::result_of_t<Action(Args...)>>;
+
+template <class Action, class... Args>
+inline constexpr bool returns_void_v = returns_void<Action, Args...>::value;
+
+// Equivalent to C++20 std::type_identity. Used to keep arguments from taking
+// part in template argument deduction.
+template <class T>
+struct type_identity {
+  using type = T;
+};
+
+template <class T>
+using type_identity_t = typename type_identity<T>::type;
+
+#if defined(CORTEX_M_ATOMICS_HOST)
+
+inline auto get_interrupt_mask() -> bool { return host::interrupts_masked(); }
+
+inline void disable_interrupts() { host::mask_interrupts(true); }
+
+inline void enable_interrupts() { host::mask_interrupts(false); }
+
+#else
+
+/*
+ * @brief Gets the state of the processors interrupt mask. This is 1 if
+ * interrupts are masked. 0 otherwise.
+ */
+inline auto get_interrupt_mask() -> bool {
+  std::uint32_t primask;
+  asm volatile("mrs %0, primask" : "=r"(primask) :);
+  return primask != 0;
+}
+
+inline void disable_interrupts() { asm volatile("cpsid i" : : : "memory"); }
+
+inline void enable_interrupts() { asm volatile("cpsie i" : : : "memory"); }
+
+#endif
+
+/**
+ * @brief Marks a point where an ISR may preempt the running code in the host
+ * model checker. Does nothing on the target.
+ */
+inline void preemption_point() {
+#if defined(CORTEX_M_ATOMICS_HOST)
+  host::preemption_point();
+#endif
+}
+
+/**
+ * @brief Runs some code within a critical section. Ensures that the interrupt
+ * state is restored if it needed to disable interrupts.
+ */
+template <class Action, std::enable_if_t<std::is_invocable_v<Action> &&
+                                             !returns_void_v<Action>,
+                                         bool> = false>
+inline auto critical_section(Action action) {
+  const auto previously_enabled = get_interrupt_mask() == 0;
+  // Disable interrupts only if they were actually enabled. Otherwise there is
+  // no harm done, as they are already disabled
+  std::uint32_t start = 0;
+  if (previously_enabled) {
+    disable_interrupts();
+    start = masked_section_begin();
+  }
+  // Other cores are not stopped by PRIMASK, whatever masked it
+  multicore_lock();
+
+  // We execute the action in the critical section and capture the return value
+  const auto retval = action();
+
+  // We reenable interrupts if we disabled them, otherwise someone else must
+  // already be relying on them being disabled, so it is not safe to reenable
+  // them at this point. no harm done, as they are already disabled
+  if (previously_enabled) {
+    masked_section_end(start);
+  }
+  multicore_unlock();
+  if (previously_enabled) {
+    enable_interrupts();
+  }
+  return retval;
+}
+
+/**
+ * @brief Runs some code within a critical section. Ensures that the interrupt
+ * state is restored if it needed to disable interrupts.
+ */
+template <class Action, std::enable_if_t<std::is_invocable_v<Action> &&
+                                             returns_void_v<Action>,
+                                         bool> = false>
+inline auto critical_section(Action action) {
+  const auto previously_enabled = get_interrupt_mask() == 0;
+  // Disable interrupts only if they were actually enabled. Otherwise there is
+  // no harm done, as they are already disabled
+  std::uint32_t start = 0;
+  if (previously_enabled) {
+    disable_interrupts();
+    start = masked_section_begin();
+  }
+  // Other cores are not stopped by PRIMASK, whatever masked it
+  multicore_lock();
+
+  // We execute the action in the critical section
+  action();
+
+  // We reenable interrupts if we disabled them, otherwise someone else must
+  // already be relying on them being disabled, so it is not safe to reenable
+  // them at this point. no harm done, as they are already disabled
+  if (previously_enabled) {
+    masked_section_end(start);
+  }
+  multicore_unlock();
+  if (previously_enabled) {
+    enable_interrupts();
+  }
+}
+
+/**
+ * @brief Orders memory accesses before the barrier with respect to the ones
+ * after it.
+ */
+inline void memory_barrier() {
+#if defined(CORTEX_M_ATOMICS_HOST)
+  host::memory_barrier();
+#else
+  asm volatile("dmb" : : : "memory");
+#endif
+}
+
+/**
+ * @brief Waits until all memory accesses before the barrier complete, which
+ * is needed when the side effects of a write to a peripheral must have taken
+ * place before continuing, e.g. clearing a pending interrupt before returning
+ * from the handler.
+ */
+inline void data_synchronization_barrier() {
+#if defined(CORTEX_M_ATOMICS_HOST)
+  host::memory_barrier();
+#else
+  asm volatile("dsb" : : : "memory");
+#endif
+}
+
+/**
+ * @brief Sleeps until an interrupt is pending. The core also wakes up if the
+ * interrupt is masked by PRIMASK, in which case the handler runs once
+ * interrupts are enabled again.
+ */
+inline void wait_for_interrupt() {
+#if defined(CORTEX_M_ATOMICS_HOST)
+  host::wait_for_interrupt();
+#else
+  asm volatile("dsb\n\twfi" : : : "memory");
+#endif
+}
+
+}  // namespace cortex_m_atomics
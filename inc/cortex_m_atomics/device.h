@@ -0,0 +1,109 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "cortex_m_atomics/critical_section.h"
+
+/*
+ * Ordering of accesses shared with other bus masters (DMA engines, Ethernet
+ * and USB controllers) and peripherals.
+ *
+ * A dmb is enough to order normal memory accesses with respect to device
+ * accesses as seen by any observer, so handing memory over to a bus master
+ * only needs a dmb. A dsb is only needed when the access must have completed
+ * before executing instructions that are not memory accesses, such as wfi, an
+ * exception return or a write to a system control register.
+ *
+ * On cores with a data cache, the cache must also be cleaned or invalidated
+ * for the buffers shared with the bus master. That is not handled here.
+ */
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Stores a value to a device register or to memory observed by another
+ * bus master. Every memory access before the store is observed before it, so
+ * it can be used to start a DMA transfer over a buffer written by the CPU.
+ */
+template <class T>
+inline void store_release_to_device(volatile T* ptr, type_identity_t<T> value) {
+  memory_barrier();
+  *ptr = value;
+}
+
+/**
+ * @brief Loads a value from a device register or from memory written by
+ * another bus master. Memory accesses after the load are observed after it, so
+ * it can be used to read a DMA status before reading the buffer it filled.
+ */
+template <class T>
+inline auto load_acquire_from_device(const volatile T* ptr) -> T {
+  const T value = *ptr;
+  memory_barrier();
+  return value;
+}
+
+/**
+ * @brief Stores a value to a device register and waits until the write has
+ * completed. Needed when the side effects of the write must have taken place
+ * before the next instruction, e.g. clearing the pending flag of an interrupt
+ * before returning from its handler, or before going to sleep.
+ */
+template <class T>
+inline void store_and_complete(volatile T* ptr, type_identity_t<T> value) {
+  *ptr = value;
+  data_synchronization_barrier();
+}
+
+/**
+ * @brief Hands a DMA descriptor over to the device by writing its control
+ * word, which must include the ownership flag. The contents of the descriptor
+ * and its buffer written before are observed by the device before the flag.
+ *
+ * Kicking the DMA engine afterwards (e.g. a poll demand register) must be done
+ * with store_release_to_device(), so the descriptor is observed before it.
+ */
+template <class T>
+inline void give_descriptor_to_device(volatile T* control,
+                                      type_identity_t<T> value) {
+  store_release_to_device(control, value);
+}
+
+/**
+ * @brief Checks if the device has returned a DMA descriptor to the CPU by
+ * clearing the ownership flags in own_mask. Only if it has, a barrier is
+ * issued so that the descriptor and its buffer are read after the flag.
+ */
+template <class T>
+inline auto take_descriptor_from_device(const volatile T* control,
+                                        type_identity_t<T> own_mask) -> bool {
+  if ((*control & own_mask) != 0) {
+    return false;
+  }
+  memory_barrier();
+  return true;
+}
+
+}  // namespace cortex_m_atomics
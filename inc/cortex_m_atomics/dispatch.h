@@ -0,0 +1,56 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Implementation the atomic intrinsics are bound to when the library is
+ * built with CORTEX_M_ATOMICS_RUNTIME_DISPATCH.
+ */
+enum class Backend {
+  // Interrupts are masked with PRIMASK around read-modify-write operations.
+  // Used on armv6-m cores and on unknown cores.
+  kPrimask,
+  // ldrex/strex loops surrounded by dmb. Used on armv7-m cores.
+  kExclusive,
+  // lda/stl and ldaex/stlex, without any dmb. Used on armv8-m cores.
+  kAcquireRelease,
+};
+
+/**
+ * @brief Returns the backend selected by cortex_m_atomics_init().
+ */
+auto backend() -> Backend;
+
+}  // namespace cortex_m_atomics
+
+/**
+ * @brief Reads the CPUID base register and binds the intrinsics to the fastest
+ * backend for the core. Runs automatically as a static constructor, but may be
+ * called earlier from the reset handler. Until it runs, the PRIMASK backend is
+ * used, which is correct on every core.
+ */
+extern "C" void cortex_m_atomics_init();
@@ -0,0 +1,98 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#if !defined(__ARM_FEATURE_LDREX) || !(__ARM_FEATURE_LDREX & 4)
+#error "cortex_m_atomics/exclusive.h requires word exclusive accesses"
+#endif
+
+#include <cstdint>
+
+#include "cortex_m_atomics/critical_section.h"
+#include "cortex_m_atomics/instrumentation.h"
+
+// Number of ldrex/strex attempts of exclusive_update() before it masks
+// interrupts, as for the runtime dispatch backends in src/dispatch.cpp
+#ifndef CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS
+#define CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS 4
+#endif
+
+namespace cortex_m_atomics {
+
+inline auto load_exclusive(volatile std::uint32_t* ptr) -> std::uint32_t {
+  std::uint32_t value;
+  asm volatile("ldrex %0, [%1]" : "=r"(value) : "r"(ptr) : "memory");
+  return value;
+}
+
+/**
+ * @brief Stores value at ptr if the exclusive monitor is still held. Returns
+ * false if it was lost, e.g. because an interrupt was taken.
+ */
+inline auto store_exclusive(volatile std::uint32_t* ptr, std::uint32_t value)
+    -> bool {
+  std::uint32_t failed;
+  asm volatile("strex %0, %2, [%1]"
+               : "=&r"(failed)
+               : "r"(ptr), "r"(value)
+               : "memory");
+  return failed == 0;
+}
+
+inline void clear_exclusive() { asm volatile("clrex" : : : "memory"); }
+
+/**
+ * @brief Atomically replaces the word at ptr with update(previous value), and
+ * returns the previous value. No barriers are issued, so the update is
+ * relaxed.
+ *
+ * An interrupt that fires faster than the sequence can complete clears the
+ * monitor every time, so after CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS failed
+ * attempts the update masks interrupts and retries there, where only another
+ * bus master writing the word can make it fail.
+ */
+template <class Update>
+inline auto exclusive_update(volatile std::uint32_t* ptr, Update update)
+    -> std::uint32_t {
+  for (std::uint32_t retries = 0;
+       retries < CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS; retries++) {
+    const std::uint32_t previous = load_exclusive(ptr);
+    if (store_exclusive(ptr, update(previous))) {
+      exclusive_sequence_end(retries, false);
+      return previous;
+    }
+  }
+  exclusive_sequence_end(CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS, true);
+
+  return critical_section([&]() {
+    std::uint32_t previous;
+    do {
+      previous = load_exclusive(ptr);
+    } while (!store_exclusive(ptr, update(previous)));
+    return previous;
+  });
+}
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,163 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "cortex_m_atomics/intrusive_lifo.h"
+#include "cortex_m_atomics/sleep.h"
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief A unit of work for the Executor. Tasks are intrusive, so posting one
+ * never allocates. A task can be posted again while it runs.
+ */
+struct Task {
+  using Handler = void (*)(void* context);
+
+  constexpr Task(Handler handler, void* context, std::uint8_t priority)
+      : handler(handler), context(context), priority(priority) {}
+
+  Task(const Task&) = delete;
+  auto operator=(const Task&) -> Task& = delete;
+
+  Handler handler;
+  void* context;
+  // Higher values run first. Must be lower than the number of priorities of
+  // the executor
+  std::uint8_t priority;
+
+  // Owned by the executor
+  Task* next = nullptr;
+  std::atomic<bool> queued{false};
+};
+
+/**
+ * @brief Returns the index of the most significant bit set in value, which
+ * must not be 0. Cores without clz use a small lookup table.
+ */
+inline auto highest_bit(std::uint32_t value) -> unsigned {
+#if defined(__ARM_FEATURE_CLZ)
+  return 31 - __builtin_clz(value);
+#else
+  static constexpr std::uint8_t kHighestBit[16] = {0, 0, 1, 1, 2, 2, 2, 2,
+                                                   3, 3, 3, 3, 3, 3, 3, 3};
+  unsigned bit = 0;
+  if ((value >> 16) != 0) {
+    value >>= 16;
+    bit += 16;
+  }
+  if ((value >> 8) != 0) {
+    value >>= 8;
+    bit += 8;
+  }
+  if ((value >> 4) != 0) {
+    value >>= 4;
+    bit += 4;
+  }
+  return bit + kHighestBit[value];
+#endif
+}
+
+/**
+ * @brief Run-to-completion executor for bare-metal main loops.
+ *
+ * ISRs and threads post tasks into per-priority IntrusiveLifos and set the
+ * bit of the priority in a ready bitmap with fetch_or. The main loop picks the
+ * highest ready priority, runs all of its tasks in the order they were posted
+ * and sleeps with wfi when nothing is ready.
+ */
+template <std::size_t kNumPriorities>
+class Executor {
+  static_assert(kNumPriorities > 0 && kNumPriorities <= 32,
+                "The ready bitmap holds up to 32 priorities");
+
+ public:
+  /**
+   * @brief Posts a task. Can be called from any context. Returns false if the
+   * task was already queued, in which case it will only run once.
+   */
+  auto post(Task& task) -> bool {
+    // The priority selects a queue and a bit of the ready bitmap
+    assert(task.priority < kNumPriorities);
+    if (task.queued.exchange(true, std::memory_order_relaxed)) {
+      return false;
+    }
+
+    queues_[task.priority].push(task);
+    ready_.fetch_or(1u << task.priority, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Runs the tasks of the highest ready priority. Must be called from
+   * thread mode. Returns false if there was nothing to run.
+   */
+  auto run_once() -> bool {
+    const auto ready = ready_.load(std::memory_order_acquire);
+    if (ready == 0) {
+      return false;
+    }
+
+    // The bit is cleared before taking the tasks, so a task posted after
+    // this point sets it again and is not missed
+    const auto priority = highest_bit(ready);
+    ready_.fetch_and(~(1u << priority), std::memory_order_relaxed);
+    Task* pending = queues_[priority].take_all();
+
+    while (pending != nullptr) {
+      Task* next = pending->next;
+      // Cleared before running, so the task can post itself again
+      pending->queued.store(false, std::memory_order_release);
+      pending->handler(pending->context);
+      pending = next;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Runs tasks forever, sleeping whenever there is nothing to run.
+   */
+  [[noreturn]] void run() {
+    for (;;) {
+      if (!run_once()) {
+        sleep_until([this]() {
+          return ready_.load(std::memory_order_relaxed) != 0;
+        });
+      }
+    }
+  }
+
+ private:
+  std::atomic<std::uint32_t> ready_{0};
+  std::array<IntrusiveLifo<Task>, kNumPriorities> queues_{};
+};
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,212 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Fixed-capacity open-addressing hash map from 32 bit keys to 32 bit
+ * values, for lookups from ISRs in tables that threads modify.
+ *
+ * Each slot holds its key and value in one 64 bit word, so that a lookup
+ * never pairs a key with the value of another one, and an update never
+ * overwrites the value of a key that reused the slot after an erase. 64 bit
+ * atomics mask interrupts for a few cycles on Cortex-M, which keeps every
+ * access wait-free.
+ *
+ * Lookups are a bounded linear probe of acquire loads, which can run from any
+ * context. Inserting and erasing are lock-free and meant for threads: every
+ * change to a slot is a compare exchange. Inserting the same key from two
+ * threads at the same time is not supported.
+ *
+ * Erased slots become tombstones, which later inserts reuse but which never
+ * become empty again, since a concurrent insert may be probing past them. A
+ * table with many erasures keeps its probe sequences as long as they were at
+ * their peak, so size it for the number of distinct keys it will hold at
+ * once plus some slack, and build a new one if lookups get slow.
+ *
+ * Keys kEmptyKey and kTombstoneKey are reserved, which is asserted.
+ */
+template <std::size_t kCapacity>
+class AtomicHashMap {
+  static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two");
+
+ public:
+  static constexpr std::uint32_t kEmptyKey = 0;
+  static constexpr std::uint32_t kTombstoneKey = 0xFFFFFFFF;
+
+  static constexpr auto is_valid_key(std::uint32_t key) -> bool {
+    return key != kEmptyKey && key != kTombstoneKey;
+  }
+
+  /**
+   * @brief Looks up a key. Returns false if it is not in the map. Wait-free,
+   * so it can be used from ISRs.
+   */
+  auto find(std::uint32_t key, std::uint32_t& value) const -> bool {
+    // A reserved key would match an empty slot or a tombstone
+    assert(is_valid_key(key));
+    auto index = home_index(key);
+    for (std::size_t probe = 0; probe < kCapacity; probe++) {
+      const auto entry = slots_[index].load(std::memory_order_acquire);
+      if (key_of(entry) == key) {
+        value = value_of(entry);
+        return true;
+      }
+      if (key_of(entry) == kEmptyKey) {
+        return false;
+      }
+      index = (index + 1) & kIndexMask;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Inserts a key, or updates its value if it is already in the map.
+   * Returns false if the map is full.
+   */
+  auto insert(std::uint32_t key, std::uint32_t value) -> bool {
+    assert(is_valid_key(key));
+    const auto new_entry = make_entry(key, value);
+    for (;;) {
+      std::atomic<std::uint64_t>* free_slot = nullptr;
+      std::uint64_t free_entry = 0;
+      bool raced = false;
+      auto index = home_index(key);
+      for (std::size_t probe = 0; probe < kCapacity; probe++) {
+        auto& slot = slots_[index];
+        auto entry = slot.load(std::memory_order_acquire);
+        if (key_of(entry) == key) {
+          // Fails if the key was erased, or its value changed, since the
+          // load. The slot may then belong to another key, so the probe
+          // starts over
+          if (slot.compare_exchange_strong(entry, new_entry,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+            return true;
+          }
+          raced = true;
+          break;
+        }
+        if (key_of(entry) == kTombstoneKey && free_slot == nullptr) {
+          free_slot = &slot;
+          free_entry = entry;
+        }
+        if (key_of(entry) == kEmptyKey) {
+          if (free_slot == nullptr) {
+            free_slot = &slot;
+            free_entry = entry;
+          }
+          break;
+        }
+        index = (index + 1) & kIndexMask;
+      }
+
+      if (raced) {
+        continue;
+      }
+      if (free_slot == nullptr) {
+        return false;
+      }
+
+      // Another thread may have claimed the slot, in which case the probe
+      // starts over
+      if (free_slot->compare_exchange_strong(free_entry, new_entry,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+  /**
+   * @brief Removes a key. Returns false if it was not in the map.
+   */
+  auto erase(std::uint32_t key) -> bool {
+    assert(is_valid_key(key));
+    auto index = home_index(key);
+    for (std::size_t probe = 0; probe < kCapacity; probe++) {
+      auto& slot = slots_[index];
+      auto entry = slot.load(std::memory_order_acquire);
+      // The slot stays occupied for probing, so the keys after it remain
+      // reachable. The compare exchange only fails if another thread updated
+      // the value in the meantime
+      while (key_of(entry) == key) {
+        if (slot.compare_exchange_weak(entry, make_entry(kTombstoneKey, 0),
+                                       std::memory_order_release,
+                                       std::memory_order_acquire)) {
+          return true;
+        }
+      }
+      if (key_of(entry) == kEmptyKey) {
+        return false;
+      }
+      index = (index + 1) & kIndexMask;
+    }
+    return false;
+  }
+
+ private:
+  static constexpr auto make_entry(std::uint32_t key, std::uint32_t value)
+      -> std::uint64_t {
+    return (std::uint64_t{value} << 32) | key;
+  }
+
+  static constexpr auto key_of(std::uint64_t entry) -> std::uint32_t {
+    return static_cast<std::uint32_t>(entry);
+  }
+
+  static constexpr auto value_of(std::uint64_t entry) -> std::uint32_t {
+    return static_cast<std::uint32_t>(entry >> 32);
+  }
+
+  static constexpr auto log2(std::size_t value) -> unsigned {
+    unsigned bits = 0;
+    while (value > 1) {
+      value >>= 1;
+      bits++;
+    }
+    return bits;
+  }
+
+  static constexpr std::size_t kIndexMask = kCapacity - 1;
+  static constexpr unsigned kHashShift = 32 - log2(kCapacity);
+
+  // Fibonacci hashing, which spreads sequential ids over the table
+  static auto home_index(std::uint32_t key) -> std::size_t {
+    return static_cast<std::uint32_t>(key * 2654435769u) >> kHashShift;
+  }
+
+  std::array<std::atomic<std::uint64_t>, kCapacity> slots_{};
+};
+
+}  // namespace cortex_m_atomics
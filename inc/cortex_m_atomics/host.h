@@ -0,0 +1,88 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Hooks of the host backend, selected with CORTEX_M_ATOMICS_HOST. The library
+ * is then built for the development machine: PRIMASK is simulated, and the
+ * intrinsics and barriers call preemption_point(), where the model checker in
+ * cortex_m_atomics/model_checker.h may run an ISR synchronously.
+ *
+ * Code using std::atomic must be compiled with -fno-inline-atomics, so that
+ * the compiler calls the intrinsics instead of using the host instructions.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cortex_m_atomics::host {
+
+/**
+ * @brief Returns the simulated PRIMASK.
+ */
+auto interrupts_masked() -> bool;
+
+/**
+ * @brief Sets the simulated PRIMASK. Unmasking interrupts is a preemption
+ * point.
+ */
+void mask_interrupts(bool masked);
+
+/**
+ * @brief A point where an ISR may preempt the running code. Does nothing when
+ * interrupts are masked or outside of ModelChecker::run().
+ */
+void preemption_point();
+
+/**
+ * @brief Aligned accesses of the atomic loads and stores. With the weak memory
+ * model of the model checker, stores are buffered and loads may return stale
+ * values until the context issues a barrier. Otherwise they access memory
+ * directly.
+ */
+auto load(const volatile void* ptr, std::size_t size) -> std::uint64_t;
+void store(volatile void* ptr, std::uint64_t value, std::size_t size);
+
+/**
+ * @brief Aligned accesses of read-modify-write operations, made with
+ * interrupts masked. They always see the latest value and are visible to
+ * every context immediately, as an exclusive access would be.
+ */
+auto locked_load(const volatile void* ptr, std::size_t size) -> std::uint64_t;
+void locked_store(volatile void* ptr, std::uint64_t value, std::size_t size);
+
+/**
+ * @brief Models dmb: the stores of the running context become visible, and
+ * its later loads see the latest values. Also a preemption point.
+ */
+void memory_barrier();
+
+/**
+ * @brief Models wfi: one of the ISRs that have not run yet must run at the
+ * next preemption point. The execution deadlocks if there is none.
+ */
+void wait_for_interrupt();
+
+}  // namespace cortex_m_atomics::host
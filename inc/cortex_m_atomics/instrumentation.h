@@ -0,0 +1,112 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Opt-in instrumentation of the interrupt latency added by the library. When
+ * built with CORTEX_M_ATOMICS_INSTRUMENTATION, every outermost
+ * critical_section() records how long it kept interrupts masked, and the
+ * exclusive backends of the runtime dispatch record how often they had to
+ * retry. Otherwise the hooks below compile to nothing.
+ */
+
+#if defined(CORTEX_M_ATOMICS_INSTRUMENTATION)
+
+/**
+ * @brief Returns a free-running cycle counter. The default implementation
+ * reads DWT CYCCNT, which the application must enable, on cores that have it,
+ * and returns 0 on armv6-m. It is a weak symbol, so it can be replaced, e.g.
+ * with a free-running timer.
+ */
+extern "C" auto cortex_m_atomics_cycle_counter() -> std::uint32_t;
+
+#endif
+
+namespace cortex_m_atomics {
+
+struct Statistics {
+  // Number of times interrupts were masked by critical_section()
+  std::uint32_t masked_sections;
+  // Longest time interrupts were masked, in cycles of
+  // cortex_m_atomics_cycle_counter()
+  std::uint32_t max_masked_cycles;
+  // Failed strex of the read-modify-writes of the runtime dispatch exclusive
+  // backends, usually because an interrupt cleared the exclusive monitor
+  std::uint32_t exclusive_retries;
+  // Read-modify-writes that ran out of exclusive attempts and masked
+  // interrupts instead
+  std::uint32_t exclusive_fallbacks;
+};
+
+#if defined(CORTEX_M_ATOMICS_INSTRUMENTATION)
+
+/**
+ * @brief Returns the statistics gathered since boot or since the last
+ * reset_statistics().
+ */
+auto statistics() -> Statistics;
+
+void reset_statistics();
+
+/**
+ * @brief Records a masked section that started at the given cycle count. Must
+ * be called with interrupts masked and the multi-core spinlock held.
+ */
+void record_masked_section(std::uint32_t start);
+
+/**
+ * @brief Records the failed strex of an exclusive read-modify-write, and
+ * whether it fell back to masking interrupts.
+ */
+void record_exclusive_retries(std::uint32_t retries, bool fell_back);
+
+inline auto masked_section_begin() -> std::uint32_t {
+  return cortex_m_atomics_cycle_counter();
+}
+
+inline void masked_section_end(std::uint32_t start) {
+  record_masked_section(start);
+}
+
+inline void exclusive_sequence_end(std::uint32_t retries, bool fell_back) {
+  // Keeps the uncontended path free of any bookkeeping
+  if (retries != 0) {
+    record_exclusive_retries(retries, fell_back);
+  }
+}
+
+#else
+
+inline auto masked_section_begin() -> std::uint32_t { return 0; }
+
+inline void masked_section_end(std::uint32_t) {}
+
+inline void exclusive_sequence_end(std::uint32_t, bool) {}
+
+#endif
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,88 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Intrusive lock-free LIFO for handing nodes from ISRs to a thread in
+ * batches.
+ *
+ * Producers push nodes with a compare exchange on the head, from any context.
+ * The consumer takes the whole list with a single exchange and reverses it
+ * locally, so draining costs one read-modify-write per batch, no matter how
+ * many nodes it holds. Exchange is the cheapest read-modify-write on armv6-m.
+ * Only one context may take nodes at a time.
+ *
+ * The link is the Node member kNext, which belongs to the list while the node
+ * is pushed.
+ */
+template <class Node, Node* Node::*kNext = &Node::next>
+class IntrusiveLifo {
+ public:
+  /**
+   * @brief Pushes a node. Can be called from any context.
+   */
+  void push(Node& node) {
+    Node* head = head_.load(std::memory_order_relaxed);
+    do {
+      node.*kNext = head;
+    } while (!head_.compare_exchange_weak(head, &node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  /**
+   * @brief Takes every node, returning them linked through kNext in the order
+   * they were pushed, or nullptr if the list was empty.
+   */
+  auto take_all() -> Node* {
+    // A plain load avoids the read-modify-write when there is nothing to take
+    if (head_.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;
+    }
+
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    Node* reversed = nullptr;
+    while (node != nullptr) {
+      Node* next = node->*kNext;
+      node->*kNext = reversed;
+      reversed = node;
+      node = next;
+    }
+    return reversed;
+  }
+
+  auto empty() const -> bool {
+    return head_.load(std::memory_order_relaxed) == nullptr;
+  }
+
+ private:
+  std::atomic<Node*> head_{nullptr};
+};
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,52 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Copies count bytes from source, which may be written concurrently,
+ * into dest, as in P1478. Each byte is read atomically, but the copy as a
+ * whole is not, so seqlock readers must validate the sequence number
+ * afterwards. The order must be relaxed, acquire or seq_cst. A single fence is
+ * issued after the copy instead of one per element.
+ */
+auto atomic_load_per_byte_memcpy(void* dest, const void* source,
+                                 std::size_t count, std::memory_order order)
+    -> void*;
+
+/**
+ * @brief Copies count bytes from source into dest, which may be read
+ * concurrently, as in P1478. Each byte is written atomically. The order must
+ * be relaxed, release or seq_cst. A single fence is issued before the copy.
+ */
+auto atomic_store_per_byte_memcpy(void* dest, const void* source,
+                                  std::size_t count, std::memory_order order)
+    -> void*;
+
+}  // namespace cortex_m_atomics
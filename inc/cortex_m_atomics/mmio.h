@@ -0,0 +1,262 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+#include "cortex_m_atomics/critical_section.h"
+
+namespace cortex_m_atomics::mmio {
+
+/**
+ * @brief Barrier issued after a register update.
+ */
+enum class Ordering {
+  // No barrier. Accesses to device memory are already issued in program order
+  kNone,
+  // A dsb after the update, for when its side effects must have taken place
+  // before continuing. E.g. enabling a peripheral clock before accessing the
+  // peripheral or clearing a pending interrupt before returning from the ISR.
+  kDevice,
+};
+
+/**
+ * @brief Update policy for registers without any hardware support for atomic
+ * updates. The read-modify-write happens within a critical section.
+ */
+struct Masked {
+  template <class T>
+  static void modify(std::uintptr_t address, T clear_mask, T set_mask) {
+    auto& reg = *reinterpret_cast<volatile T*>(address);
+    critical_section([&]() { reg = (reg & ~clear_mask) | set_mask; });
+  }
+
+  template <class T>
+  static void set_bits(std::uintptr_t address, T mask) {
+    modify<T>(address, 0, mask);
+  }
+
+  template <class T>
+  static void clear_bits(std::uintptr_t address, T mask) {
+    modify<T>(address, mask, 0);
+  }
+
+  template <class T>
+  static void toggle_bits(std::uintptr_t address, T mask) {
+    auto& reg = *reinterpret_cast<volatile T*>(address);
+    critical_section([&]() { reg = reg ^ mask; });
+  }
+};
+
+/**
+ * @brief Offset value for alias registers not implemented by a peripheral.
+ */
+inline constexpr std::uintptr_t kNoAlias = 0;
+
+/**
+ * @brief Update policy for peripherals with set, clear and toggle alias
+ * registers, where writing a mask to the alias updates only the bits in the
+ * mask. Each update is a single store. The offsets are relative to the
+ * address of the register, e.g. +0x2000, +0x3000 and +0x1000 on the RP2040.
+ *
+ * Aliases not implemented by the peripheral fall back to a masked
+ * read-modify-write. Updates that both clear and set bits always do, because
+ * two alias writes would make the intermediate value visible.
+ */
+template <std::uintptr_t kSetOffset, std::uintptr_t kClearOffset,
+          std::uintptr_t kToggleOffset = kNoAlias>
+struct SetClearAliases {
+  template <class T>
+  static void modify(std::uintptr_t address, T clear_mask, T set_mask) {
+    Masked::modify<T>(address, clear_mask, set_mask);
+  }
+
+  template <class T>
+  static void set_bits(std::uintptr_t address, T mask) {
+    if constexpr (kSetOffset != kNoAlias) {
+      *reinterpret_cast<volatile T*>(address + kSetOffset) = mask;
+    } else {
+      Masked::set_bits<T>(address, mask);
+    }
+  }
+
+  template <class T>
+  static void clear_bits(std::uintptr_t address, T mask) {
+    if constexpr (kClearOffset != kNoAlias) {
+      *reinterpret_cast<volatile T*>(address + kClearOffset) = mask;
+    } else {
+      Masked::clear_bits<T>(address, mask);
+    }
+  }
+
+  template <class T>
+  static void toggle_bits(std::uintptr_t address, T mask) {
+    if constexpr (kToggleOffset != kNoAlias) {
+      *reinterpret_cast<volatile T*>(address + kToggleOffset) = mask;
+    } else {
+      Masked::toggle_bits<T>(address, mask);
+    }
+  }
+};
+
+inline constexpr std::uintptr_t kBitBandRegionMask = 0xF0000000;
+inline constexpr std::uintptr_t kSramBitBandRegion = 0x20000000;
+inline constexpr std::uintptr_t kPeripheralBitBandRegion = 0x40000000;
+inline constexpr std::uintptr_t kBitBandRegionSize = 0x00100000;
+
+/**
+ * @brief Checks if an address lies in the first 1 MiB of the SRAM or
+ * peripheral regions, which are the only ones with a bit-band alias.
+ */
+constexpr auto is_bit_band_address(std::uintptr_t address) -> bool {
+  const auto region = address & kBitBandRegionMask;
+  const auto offset = address & ~kBitBandRegionMask;
+  return (region == kSramBitBandRegion ||
+          region == kPeripheralBitBandRegion) &&
+         offset < kBitBandRegionSize;
+}
+
+/**
+ * @brief Returns the bit-band alias of a bit in the SRAM or peripheral
+ * bit-band regions of the Cortex-M3 and Cortex-M4.
+ */
+constexpr auto bit_band_alias(std::uintptr_t address, unsigned bit)
+    -> std::uintptr_t {
+  assert(is_bit_band_address(address) && bit < 32);
+  constexpr std::uintptr_t kAliasOffset = 0x02000000;
+  const auto region = address & kBitBandRegionMask;
+  const auto offset = address & ~kBitBandRegionMask;
+  return region + kAliasOffset + (offset * 32) + (bit * 4);
+}
+
+/**
+ * @brief Update policy for registers in a bit-band region. Setting and
+ * clearing bits is a single store per bit, so it is best suited for masks with
+ * one or a few bits. Every bit is updated atomically, but a multi-bit update
+ * is not atomic as a whole. Toggling and updates that both clear and set bits
+ * fall back to a masked read-modify-write.
+ *
+ * A write to the alias is still a read-modify-write of the whole word on the
+ * bus, which is only locked against other bus masters. Do not use it on
+ * registers with write-1-to-clear bits, such as interrupt flags, since the
+ * bits that read as 1 are written back and cleared, nor on registers whose
+ * reads have side effects.
+ */
+struct BitBand {
+  template <class T>
+  static void modify(std::uintptr_t address, T clear_mask, T set_mask) {
+    Masked::modify<T>(address, clear_mask, set_mask);
+  }
+
+  template <class T>
+  static void set_bits(std::uintptr_t address, T mask) {
+    write_bits<T>(address, mask, 1);
+  }
+
+  template <class T>
+  static void clear_bits(std::uintptr_t address, T mask) {
+    write_bits<T>(address, mask, 0);
+  }
+
+  template <class T>
+  static void toggle_bits(std::uintptr_t address, T mask) {
+    Masked::toggle_bits<T>(address, mask);
+  }
+
+ private:
+  template <class T>
+  static void write_bits(std::uintptr_t address, T mask, std::uint32_t value) {
+    for (unsigned bit = 0; mask != 0; bit++, mask >>= 1) {
+      if ((mask & 1) != 0) {
+        *reinterpret_cast<volatile std::uint32_t*>(
+            bit_band_alias(address, bit)) = value;
+      }
+    }
+  }
+};
+
+/**
+ * @brief A memory-mapped register that is updated from both threads and ISRs.
+ * The policy selects the cheapest mechanism the peripheral supports to update
+ * the register atomically.
+ */
+template <class T, class Policy = Masked>
+class Register {
+  static_assert(std::is_unsigned_v<T> && sizeof(T) <= sizeof(std::uint32_t),
+                "Registers must be unsigned integers of up to 32 bits");
+
+ public:
+  explicit constexpr Register(std::uintptr_t address) : address_(address) {
+    // Fails to compile for constexpr registers outside of the regions
+    if constexpr (std::is_same_v<Policy, BitBand>) {
+      assert(is_bit_band_address(address));
+    }
+  }
+
+  auto read() const -> T { return *reinterpret_cast<volatile T*>(address_); }
+
+  void write(T value, Ordering ordering = Ordering::kNone) const {
+    *reinterpret_cast<volatile T*>(address_) = value;
+    sync(ordering);
+  }
+
+  void set_bits(T mask, Ordering ordering = Ordering::kNone) const {
+    Policy::template set_bits<T>(address_, mask);
+    sync(ordering);
+  }
+
+  void clear_bits(T mask, Ordering ordering = Ordering::kNone) const {
+    Policy::template clear_bits<T>(address_, mask);
+    sync(ordering);
+  }
+
+  void toggle_bits(T mask, Ordering ordering = Ordering::kNone) const {
+    Policy::template toggle_bits<T>(address_, mask);
+    sync(ordering);
+  }
+
+  /**
+   * @brief Clears the bits in clear_mask and sets the ones in set_mask as a
+   * single atomic update.
+   */
+  void modify(T clear_mask, T set_mask,
+              Ordering ordering = Ordering::kNone) const {
+    Policy::template modify<T>(address_, clear_mask, set_mask);
+    sync(ordering);
+  }
+
+ private:
+  static void sync(Ordering ordering) {
+    if (ordering == Ordering::kDevice) {
+      data_synchronization_barrier();
+    }
+  }
+
+  std::uintptr_t address_;
+};
+
+}  // namespace cortex_m_atomics::mmio
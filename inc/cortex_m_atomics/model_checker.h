@@ -0,0 +1,108 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#if !defined(CORTEX_M_ATOMICS_HOST)
+#error "cortex_m_atomics/model_checker.h requires the host backend"
+#endif
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cortex_m_atomics::host {
+
+/**
+ * @brief Systematic tester for code shared by a thread and ISRs, in the style
+ * of CHESS.
+ *
+ * Runs a small test program over and over, once per schedule, until every
+ * schedule has been explored. Every intrinsic entry and exit, barrier and
+ * point where interrupts are unmasked is a preemption point, and in each
+ * schedule every ISR preempts the thread, or a lower priority ISR, at a
+ * different one. Each ISR runs exactly once per execution, and ISRs that have
+ * not run when the thread returns run at the end. The ISRs are given in
+ * increasing priority order.
+ *
+ * By default the host is modelled as a single core, so this finds
+ * interleaving bugs, such as missing critical sections or lost wakeups, but
+ * not missing barriers. MemoryModel::kWeak finds those too, which is what the
+ * litmus tests in test/litmus_test.cpp do. The program must be deterministic,
+ * and the shared state must be reset by setup.
+ */
+class ModelChecker {
+ public:
+  using Function = std::function<void()>;
+
+  /**
+   * @brief How the contexts observe the atomic loads and stores of each other.
+   */
+  enum class MemoryModel {
+    // In program order, as the ISRs of a single core do
+    kSequential,
+    // As if every context ran on a different core of a weakly ordered
+    // machine. Stores are buffered and may become visible in any order, and
+    // loads may return stale values, until the context issues a barrier.
+    // Stores to the same location stay in order, and read-modify-write
+    // operations always see the latest value. A load never returns a value
+    // stored after it in the schedule, so load buffering (LB) outcomes, where
+    // two contexts read the values each other stores later, are not produced.
+    kWeak,
+  };
+
+  struct Result {
+    // Number of executions explored
+    std::size_t executions = 0;
+    bool passed = true;
+    // Why the first failing execution failed, and its schedule
+    std::string failure;
+  };
+
+  ModelChecker(Function setup, Function thread, std::vector<Function> isrs,
+               std::function<bool()> check,
+               MemoryModel memory_model = MemoryModel::kSequential);
+
+  /**
+   * @brief Explores the schedules, stopping at the first failing one or after
+   * max_executions, if it is not 0.
+   */
+  auto run(std::size_t max_executions = 0) -> Result;
+
+ private:
+  Function setup_;
+  Function thread_;
+  std::vector<Function> isrs_;
+  std::function<bool()> check_;
+  MemoryModel memory_model_;
+};
+
+/**
+ * @brief Fails the current execution, e.g. when the thread or an ISR sees an
+ * invalid state.
+ */
+[[noreturn]] void fail(const std::string& message);
+
+}  // namespace cortex_m_atomics::host
@@ -0,0 +1,130 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue, after Dmitry Vyukov's
+ * design.
+ *
+ * Each cell holds a sequence number telling whether it is ready to be written
+ * or read for a given position. Producers and consumers claim positions with
+ * a compare exchange on separate counters, so they only contend with their
+ * own kind, and hand the cell over with a release store of the sequence. All
+ * atomics are 4 bytes. On parts with several cores, the library must be built
+ * with CORTEX_M_ATOMICS_MULTICORE when the compare exchange is not lock-free.
+ *
+ * try_push() and try_pop() never wait for another context. A context that is
+ * preempted between claiming a cell and handing it over makes the cell look
+ * full or empty until it resumes, so ISRs must not spin on them.
+ */
+template <class T, std::size_t kCapacity>
+class MpmcQueue {
+  static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two");
+
+ public:
+  MpmcQueue() {
+    for (std::size_t i = 0; i < kCapacity; i++) {
+      cells_[i].sequence.store(static_cast<std::uint32_t>(i),
+                               std::memory_order_relaxed);
+    }
+  }
+
+  MpmcQueue(const MpmcQueue&) = delete;
+  auto operator=(const MpmcQueue&) -> MpmcQueue& = delete;
+
+  /**
+   * @brief Pushes a value. Returns false if the queue is full.
+   */
+  auto try_push(const T& value) -> bool {
+    auto position = push_position_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& cell = cells_[position & kIndexMask];
+      const auto sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto distance = static_cast<std::int32_t>(sequence - position);
+      if (distance == 0) {
+        if (push_position_.compare_exchange_weak(position, position + 1,
+                                                 std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (distance < 0) {
+        // The cell has not been popped since the previous lap
+        return false;
+      } else {
+        position = push_position_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Pops a value. Returns false if the queue is empty.
+   */
+  auto try_pop(T& value) -> bool {
+    auto position = pop_position_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& cell = cells_[position & kIndexMask];
+      const auto sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto distance =
+          static_cast<std::int32_t>(sequence - (position + 1));
+      if (distance == 0) {
+        if (pop_position_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+          value = cell.value;
+          cell.sequence.store(position + kCapacity,
+                              std::memory_order_release);
+          return true;
+        }
+      } else if (distance < 0) {
+        // The cell has not been pushed in this lap
+        return false;
+      } else {
+        position = pop_position_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  static constexpr std::uint32_t kIndexMask = kCapacity - 1;
+
+  struct Cell {
+    std::atomic<std::uint32_t> sequence;
+    T value;
+  };
+
+  std::array<Cell, kCapacity> cells_{};
+  std::atomic<std::uint32_t> push_position_{0};
+  std::atomic<std::uint32_t> pop_position_{0};
+};
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,86 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Support for parts with several cores sharing memory, selected with
+ * CORTEX_M_ATOMICS_MULTICORE.
+ *
+ * PRIMASK only masks the interrupts of the core that sets it, so every
+ * critical_section() also takes a spinlock shared by all cores, which the
+ * application provides, e.g. with a hardware spinlock of the part. The lock
+ * is taken when the core enters its outermost critical section, whether or
+ * not interrupts were already masked, and released when it leaves it. Atomic
+ * stores take it too, so that they cannot land in the middle of a
+ * read-modify-write operation of another core.
+ */
+
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+
+#if !defined(CORTEX_M_ATOMICS_MAX_CORES)
+#define CORTEX_M_ATOMICS_MAX_CORES 2
+#endif
+
+/**
+ * @brief Takes and releases the spinlock shared by all cores. Provided by the
+ * application. Called with interrupts masked, and never recursively on the
+ * same core.
+ */
+extern "C" void cortex_m_atomics_spinlock_acquire();
+extern "C" void cortex_m_atomics_spinlock_release();
+
+/**
+ * @brief Returns the number of the running core, lower than
+ * CORTEX_M_ATOMICS_MAX_CORES. Provided by the application.
+ */
+extern "C" auto cortex_m_atomics_core_id() -> std::uint32_t;
+
+/**
+ * @brief Enters and leaves a critical section of the running core, taking the
+ * spinlock on the outermost one. Must be called with interrupts masked.
+ * Defined in src/multicore.cpp, and also used by the C inline atomics.
+ */
+extern "C" void cortex_m_atomics_multicore_lock();
+extern "C" void cortex_m_atomics_multicore_unlock();
+
+#endif
+
+namespace cortex_m_atomics {
+
+inline void multicore_lock() {
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  cortex_m_atomics_multicore_lock();
+#endif
+}
+
+inline void multicore_unlock() {
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  cortex_m_atomics_multicore_unlock();
+#endif
+}
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,157 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__ARM_FEATURE_LDREX) && (__ARM_FEATURE_LDREX & 4)
+#include "cortex_m_atomics/exclusive.h"
+#else
+#include "cortex_m_atomics/critical_section.h"
+#endif
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief What an update does when a lane would overflow or underflow.
+ */
+enum class Overflow {
+  kWrap,
+  kSaturate,
+};
+
+/**
+ * @brief Array of small counters packed into 32 bit words, instead of one
+ * padded std::atomic per counter.
+ *
+ * Every update is a read-modify-write of the word holding the lane, with
+ * ldrex/strex where available and critical_section() on armv6-m, so the
+ * other lanes of the word are never disturbed. Reading a whole word gives a
+ * consistent snapshot of all of its lanes. Updates are relaxed, which is
+ * enough for statistics. Use lane_value() to extract a lane from a snapshot.
+ *
+ * kOverflow selects whether the lanes wrap around or saturate, so that the
+ * choice is made once per array instead of at every update.
+ */
+template <class Lane, std::size_t kNumLanes,
+          Overflow kOverflow = Overflow::kWrap>
+class PackedCounters {
+  static_assert(std::is_same_v<Lane, std::uint8_t> ||
+                    std::is_same_v<Lane, std::uint16_t>,
+                "Lanes must be 8 or 16 bits wide");
+
+ public:
+  static constexpr std::size_t kLanesPerWord =
+      sizeof(std::uint32_t) / sizeof(Lane);
+  static constexpr std::size_t kNumWords =
+      (kNumLanes + kLanesPerWord - 1) / kLanesPerWord;
+
+  /**
+   * @brief Adds value to a lane and returns its previous value.
+   */
+  auto add(std::size_t lane, Lane value) -> Lane {
+    return update_lane(lane, [&](Lane current) -> Lane {
+      if constexpr (kOverflow == Overflow::kSaturate) {
+        if (current > kMaxLane - value) {
+          return kMaxLane;
+        }
+      }
+      return static_cast<Lane>(current + value);
+    });
+  }
+
+  /**
+   * @brief Subtracts value from a lane and returns its previous value.
+   */
+  auto sub(std::size_t lane, Lane value) -> Lane {
+    return update_lane(lane, [&](Lane current) -> Lane {
+      if constexpr (kOverflow == Overflow::kSaturate) {
+        if (current < value) {
+          return 0;
+        }
+      }
+      return static_cast<Lane>(current - value);
+    });
+  }
+
+  /**
+   * @brief Resets a lane to 0 and returns its previous value.
+   */
+  auto reset(std::size_t lane) -> Lane {
+    return update_lane(lane, [](Lane) -> Lane { return 0; });
+  }
+
+  auto load(std::size_t lane) const -> Lane {
+    return lane_value(load_word(lane / kLanesPerWord), lane % kLanesPerWord);
+  }
+
+  /**
+   * @brief Returns a snapshot of the kLanesPerWord lanes starting at lane
+   * word * kLanesPerWord.
+   */
+  auto load_word(std::size_t word) const -> std::uint32_t {
+    return words_[word];
+  }
+
+  /**
+   * @brief Extracts lane index of a word returned by load_word().
+   */
+  static constexpr auto lane_value(std::uint32_t word, std::size_t index)
+      -> Lane {
+    return static_cast<Lane>(word >> (index * kLaneBits));
+  }
+
+ private:
+  static constexpr unsigned kLaneBits = 8 * sizeof(Lane);
+  static constexpr Lane kMaxLane = static_cast<Lane>(~Lane{0});
+
+  template <class Update>
+  auto update_lane(std::size_t lane, Update update) -> Lane {
+    const auto shift = (lane % kLanesPerWord) * kLaneBits;
+    const auto mask = std::uint32_t{kMaxLane} << shift;
+    auto update_word = [&](std::uint32_t word) -> std::uint32_t {
+      const auto value = update(static_cast<Lane>(word >> shift));
+      return (word & ~mask) | (std::uint32_t{value} << shift);
+    };
+
+    volatile std::uint32_t* word = &words_[lane / kLanesPerWord];
+#if defined(__ARM_FEATURE_LDREX) && (__ARM_FEATURE_LDREX & 4)
+    const auto previous = exclusive_update(word, update_word);
+#else
+    const auto previous = critical_section([&]() {
+      const std::uint32_t current = *word;
+      *word = update_word(current);
+      return current;
+    });
+#endif
+    return static_cast<Lane>(previous >> shift);
+  }
+
+  volatile std::uint32_t words_[kNumWords] = {};
+};
+
+}  // namespace cortex_m_atomics
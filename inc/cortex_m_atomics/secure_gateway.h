@@ -0,0 +1,114 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Atomics on memory shared between the secure and non-secure worlds of an
+ * armv8-m core with the Security Extension.
+ *
+ * The secure image registers the shared region and exports the functions
+ * below through its non-secure callable veneers. Non-secure code links against
+ * the import library generated with --cmse-implib and calls them like regular
+ * functions. Each call costs an sg instruction plus bounds checks, instead of
+ * a full secure service request.
+ */
+
+#if defined(__ARM_FEATURE_CMSE) && (__ARM_FEATURE_CMSE == 3)
+#define CORTEX_M_ATOMICS_NONSECURE_ENTRY __attribute__((cmse_nonsecure_entry))
+#else
+#define CORTEX_M_ATOMICS_NONSECURE_ENTRY
+#endif
+
+extern "C" {
+
+/**
+ * @brief Atomic accesses to words of the registered shared region, with
+ * sequentially consistent ordering. Pointers outside of the region, that are
+ * not word aligned, or that the non-secure caller could not access itself
+ * are ignored: loads and read-modify-write operations return 0 and compare
+ * exchange returns the complement of expected, so that it never appears to
+ * succeed.
+ */
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_load_4(
+    const std::uint32_t* ptr) -> std::uint32_t;
+CORTEX_M_ATOMICS_NONSECURE_ENTRY void cma_secure_atomic_store_4(
+    std::uint32_t* ptr, std::uint32_t value);
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_exchange_4(
+    std::uint32_t* ptr, std::uint32_t value) -> std::uint32_t;
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_compare_exchange_4(
+    std::uint32_t* ptr, std::uint32_t expected, std::uint32_t desired)
+    -> std::uint32_t;
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_fetch_add_4(
+    std::uint32_t* ptr, std::uint32_t value) -> std::uint32_t;
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_fetch_sub_4(
+    std::uint32_t* ptr, std::uint32_t value) -> std::uint32_t;
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_fetch_or_4(
+    std::uint32_t* ptr, std::uint32_t value) -> std::uint32_t;
+CORTEX_M_ATOMICS_NONSECURE_ENTRY auto cma_secure_atomic_fetch_and_4(
+    std::uint32_t* ptr, std::uint32_t value) -> std::uint32_t;
+}
+
+#if defined(__ARM_FEATURE_CMSE) && (__ARM_FEATURE_CMSE == 3)
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Registers the region the non-secure callable functions operate on.
+ * Must be called by the secure image before the non-secure image starts.
+ * Only one region is supported, registering another one replaces it.
+ */
+void register_secure_shared_region(void* base, std::size_t size);
+
+/**
+ * @brief Masks interrupts from secure code for the lifetime of the object.
+ *
+ * In secure state PRIMASK refers to PRIMASK_S, which masks the configurable
+ * exceptions of both worlds. Non-secure code can only write PRIMASK_NS, so it
+ * can neither unmask a secure critical section nor preempt it.
+ */
+class SecureInterruptMask {
+ public:
+  SecureInterruptMask() {
+    asm volatile("mrs %0, primask" : "=r"(primask_) : : "memory");
+    asm volatile("cpsid i" : : : "memory");
+  }
+
+  ~SecureInterruptMask() {
+    asm volatile("msr primask, %0" : : "r"(primask_) : "memory");
+  }
+
+  SecureInterruptMask(const SecureInterruptMask&) = delete;
+  auto operator=(const SecureInterruptMask&) -> SecureInterruptMask& = delete;
+
+ private:
+  std::uint32_t primask_;
+};
+
+}  // namespace cortex_m_atomics
+
+#endif
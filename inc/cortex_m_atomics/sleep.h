@@ -0,0 +1,64 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <type_traits>
+
+#include "cortex_m_atomics/critical_section.h"
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Sleeps until pred returns true, without losing wakeups.
+ *
+ * Checking for work and then executing wfi loses the wakeup of an interrupt
+ * that arrives in between, since its handler runs before the wfi. Here, pred
+ * is evaluated with interrupts masked and wfi executes while they are still
+ * masked. A pending interrupt wakes up the core even then, and its handler
+ * runs as soon as interrupts are enabled again, after which pred is checked
+ * once more.
+ *
+ * pred runs with interrupts masked, so it should only check a few atomic
+ * flags. Must be called with interrupts enabled, otherwise the handlers that
+ * make pred true can never run. Returns with interrupts enabled.
+ */
+template <class Predicate>
+void sleep_until(Predicate pred) {
+  static_assert(std::is_invocable_r_v<bool, Predicate>,
+                "The predicate must return a bool");
+
+  for (;;) {
+    disable_interrupts();
+    if (pred()) {
+      break;
+    }
+    wait_for_interrupt();
+    // The handler of the interrupt that woke up the core runs here
+    enable_interrupts();
+  }
+  enable_interrupts();
+}
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,135 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief Pointer to a T with a counter stored in its alignment bits, so that
+ * pointer and tag fit a single word. Pointees must be aligned to kAlignment.
+ * The tag has log2(kAlignment) bits and wraps around, so over-aligning the
+ * pointees, e.g. with alignas(16), makes ABA less likely.
+ */
+template <class T, std::size_t kAlignment = alignof(T)>
+class TaggedPtr {
+  static_assert(kAlignment >= 2 && (kAlignment & (kAlignment - 1)) == 0,
+                "The alignment must be a power of two of at least 2");
+
+ public:
+  static constexpr std::uintptr_t kTagMask = kAlignment - 1;
+
+  constexpr TaggedPtr() = default;
+
+  TaggedPtr(T* ptr, std::uintptr_t tag)
+      : value_{reinterpret_cast<std::uintptr_t>(ptr) | (tag & kTagMask)} {
+    // A misaligned pointer would lose its low bits to the tag
+    assert((reinterpret_cast<std::uintptr_t>(ptr) & kTagMask) == 0);
+  }
+
+  auto ptr() const -> T* { return reinterpret_cast<T*>(value_ & ~kTagMask); }
+
+  auto tag() const -> std::uintptr_t { return value_ & kTagMask; }
+
+  /**
+   * @brief Returns a tagged pointer to ptr with the next tag, which is what a
+   * compare exchange replacing this value should store.
+   */
+  auto next(T* ptr) const -> TaggedPtr { return TaggedPtr{ptr, tag() + 1}; }
+
+  friend auto operator==(TaggedPtr lhs, TaggedPtr rhs) -> bool {
+    return lhs.value_ == rhs.value_;
+  }
+
+  friend auto operator!=(TaggedPtr lhs, TaggedPtr rhs) -> bool {
+    return lhs.value_ != rhs.value_;
+  }
+
+ private:
+  template <class, std::size_t>
+  friend class AtomicTaggedPtr;
+
+  explicit constexpr TaggedPtr(std::uintptr_t value) : value_{value} {}
+
+  std::uintptr_t value_ = 0;
+};
+
+/**
+ * @brief Atomic TaggedPtr. Every operation is a 4 byte atomic, which is
+ * lock-free or the cheapest read-modify-write on every backend, instead of the
+ * masked 8 byte intrinsics a pointer and a separate counter would need.
+ */
+template <class T, std::size_t kAlignment = alignof(T)>
+class AtomicTaggedPtr {
+ public:
+  using Value = TaggedPtr<T, kAlignment>;
+
+  constexpr AtomicTaggedPtr() = default;
+
+  explicit AtomicTaggedPtr(Value value) : value_{value.value_} {}
+
+  auto load(std::memory_order order = std::memory_order_seq_cst) const
+      -> Value {
+    return Value{value_.load(order)};
+  }
+
+  void store(Value value,
+             std::memory_order order = std::memory_order_seq_cst) {
+    value_.store(value.value_, order);
+  }
+
+  /**
+   * @brief Replaces expected with desired. On failure, expected is updated
+   * with the current value.
+   */
+  auto compare_exchange(Value& expected, Value desired,
+                        std::memory_order success = std::memory_order_seq_cst,
+                        std::memory_order failure = std::memory_order_seq_cst)
+      -> bool {
+    return value_.compare_exchange_strong(expected.value_, desired.value_,
+                                          success, failure);
+  }
+
+  /**
+   * @brief Replaces expected with ptr, tagged with the tag following the one
+   * of expected. This is the operation lock-free structures use to detect that
+   * the value changed and changed back since expected was read.
+   */
+  auto compare_exchange(Value& expected, T* ptr,
+                        std::memory_order success = std::memory_order_seq_cst,
+                        std::memory_order failure = std::memory_order_seq_cst)
+      -> bool {
+    return compare_exchange(expected, expected.next(ptr), success, failure);
+  }
+
+ private:
+  std::atomic<std::uintptr_t> value_{0};
+};
+
+}  // namespace cortex_m_atomics
@@ -0,0 +1,290 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "cortex_m_atomics/intrusive_lifo.h"
+
+namespace cortex_m_atomics {
+
+/**
+ * @brief A software timer for the TimerWheel. Timers are intrusive, so arming
+ * one never allocates.
+ *
+ * The wheel links armed timers into its slots, so a timer must outlive its
+ * time in the wheel: once armed, it may only be destroyed after it expired or
+ * was cancelled and TimerWheel::is_idle() returns true for it.
+ */
+struct Timer {
+  using Callback = void (*)(void* context);
+
+  // The low bits of state hold one of these. The rest is a generation that
+  // every arm() increments, so that the wheel can tell that a timer was armed
+  // again while it was expiring
+  static constexpr std::uint32_t kIdle = 0;
+  static constexpr std::uint32_t kArmed = 1;
+  static constexpr std::uint32_t kCancelled = 2;
+  static constexpr std::uint32_t kStateMask = 3;
+  static constexpr std::uint32_t kGeneration = 4;
+
+  constexpr Timer(Callback callback, void* context)
+      : callback(callback), context(context) {}
+
+  Timer(const Timer&) = delete;
+  auto operator=(const Timer&) -> Timer& = delete;
+
+  Callback callback;
+  void* context;
+
+  // Owned by the wheel
+  std::atomic<std::uint32_t> deadline{0};
+  std::atomic<std::uint32_t> state{kIdle};
+  std::atomic<bool> pending{false};
+  Timer* next = nullptr;
+  Timer* slot_next = nullptr;
+  Timer** slot_link = nullptr;
+};
+
+/**
+ * @brief Hierarchical timer wheel with lock-free arming and cancellation.
+ *
+ * Time is counted in ticks, and tick() must be called from a single context,
+ * typically the SysTick handler. Each level has 2^kSlotBits slots covering
+ * kSlotBits more bits of the time to the deadline than the previous one, and
+ * timers cascade down a level whenever the lower levels wrap around.
+ *
+ * arm() and cancel() can be called from any context and are O(1) without
+ * masking interrupts. Arming pushes the timer onto an IntrusiveLifo, which
+ * tick() drains with one exchange to place the timers in their slots, since
+ * only tick() knows which slots have already expired. Cancelling marks the
+ * timer and pushes it onto the same list, so the next tick() unlinks it from
+ * its slot. Callbacks run from tick() and may arm their timer again.
+ *
+ * Deadlines are absolute and must be less than 2^31 ticks away.
+ */
+template <std::size_t kNumLevels = 4, std::size_t kSlotBits = 6>
+class TimerWheel {
+  static_assert(kNumLevels > 0 && kSlotBits > 0 &&
+                    kNumLevels * kSlotBits <= 32,
+                "The levels cannot cover more than 32 bits of time");
+
+ public:
+  /**
+   * @brief Returns the number of ticks elapsed.
+   */
+  auto now() const -> std::uint32_t {
+    return now_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Arms a timer to expire at an absolute tick count, re-arming it if
+   * it was already armed. A timer must not be armed or cancelled from two
+   * contexts at the same time.
+   */
+  void arm(Timer& timer, std::uint32_t deadline) {
+    timer.deadline.store(deadline, std::memory_order_relaxed);
+    const auto state = timer.state.load(std::memory_order_relaxed);
+    timer.state.store(
+        ((state & ~Timer::kStateMask) + Timer::kGeneration) | Timer::kArmed,
+        std::memory_order_release);
+    if (!timer.pending.exchange(true)) {
+      pending_.push(timer);
+    }
+  }
+
+  /**
+   * @brief Arms a timer to expire after a number of ticks.
+   */
+  void arm_after(Timer& timer, std::uint32_t ticks) {
+    arm(timer, now() + ticks);
+  }
+
+  /**
+   * @brief Cancels a timer. Returns false if it was not armed, e.g. because it
+   * already expired. The wheel keeps the timer linked until the next tick(),
+   * so it must not be destroyed before is_idle() returns true for it.
+   */
+  auto cancel(Timer& timer) -> bool {
+    auto state = timer.state.load(std::memory_order_relaxed);
+    do {
+      if ((state & Timer::kStateMask) != Timer::kArmed) {
+        return false;
+      }
+    } while (!timer.state.compare_exchange_weak(
+        state, (state & ~Timer::kStateMask) | Timer::kCancelled,
+        std::memory_order_relaxed, std::memory_order_relaxed));
+    if (!timer.pending.exchange(true)) {
+      pending_.push(timer);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns true if the wheel holds no reference to the timer, so that
+   * it can be destroyed. A cancelled timer becomes idle on the next tick().
+   * The callback of an expired timer may still be running from tick() when
+   * this returns true.
+   */
+  static auto is_idle(const Timer& timer) -> bool {
+    return (timer.state.load(std::memory_order_acquire) &
+            Timer::kStateMask) == Timer::kIdle &&
+           !timer.pending.load();
+  }
+
+  /**
+   * @brief Advances time by one tick and runs the callbacks of the timers
+   * that expire.
+   */
+  void tick() {
+    const auto now = now_.load(std::memory_order_relaxed) + 1;
+    now_.store(now, std::memory_order_relaxed);
+
+    place_pending(now);
+
+    // Higher levels first, since they cascade into the lower ones
+    for (std::size_t level = kNumLevels - 1; level > 0; level--) {
+      if ((now & ((1u << (kSlotBits * level)) - 1)) == 0) {
+        process_slot(level, slot_index(level, now), now);
+      }
+    }
+    process_slot(0, slot_index(0, now), now);
+  }
+
+ private:
+  static constexpr std::size_t kNumSlots = std::size_t{1} << kSlotBits;
+
+  static auto slot_index(std::size_t level, std::uint32_t time)
+      -> std::size_t {
+    return (time >> (kSlotBits * level)) & (kNumSlots - 1);
+  }
+
+  static auto is_expired(std::uint32_t deadline, std::uint32_t now) -> bool {
+    return static_cast<std::int32_t>(deadline - now) <= 0;
+  }
+
+  void place_pending(std::uint32_t now) {
+    Timer* timer = pending_.take_all();
+    while (timer != nullptr) {
+      // Once pending is cleared the timer may be pushed again, overwriting
+      // next
+      Timer* next = timer->next;
+      timer->pending.store(false);
+      unlink(*timer);
+
+      // Sequentially consistent with the exchange of pending in arm(), so an
+      // arm() that did not push the timer again is seen here
+      auto state = timer->state.load();
+      if ((state & Timer::kStateMask) == Timer::kArmed) {
+        insert(*timer, now);
+      } else if ((state & Timer::kStateMask) == Timer::kCancelled) {
+        // Release, so that is_idle() sees the timer unlinked
+        timer->state.compare_exchange_strong(
+            state, state & ~Timer::kStateMask, std::memory_order_release,
+            std::memory_order_relaxed);
+      }
+      timer = next;
+    }
+  }
+
+  /**
+   * @brief Takes every timer in a slot. Armed timers are placed again, which
+   * moves them to a lower level or, at level 0, runs them if they expired.
+   */
+  void process_slot(std::size_t level, std::size_t index, std::uint32_t now) {
+    Timer* timer = slots_[level][index];
+    slots_[level][index] = nullptr;
+    while (timer != nullptr) {
+      Timer* next = timer->slot_next;
+      timer->slot_next = nullptr;
+      timer->slot_link = nullptr;
+
+      auto state = timer->state.load(std::memory_order_acquire);
+      const auto idle = state & ~Timer::kStateMask;
+      if ((state & Timer::kStateMask) == Timer::kCancelled) {
+        timer->state.compare_exchange_strong(state, idle,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed);
+      } else if ((state & Timer::kStateMask) == Timer::kArmed) {
+        if (!is_expired(timer->deadline.load(std::memory_order_relaxed),
+                        now)) {
+          insert(*timer, now);
+        } else if (timer->state.compare_exchange_strong(
+                       state, idle, std::memory_order_acq_rel,
+                       std::memory_order_relaxed)) {
+          // Fails if the timer was cancelled or armed again in the meantime
+          timer->callback(timer->context);
+        }
+      }
+      timer = next;
+    }
+  }
+
+  void insert(Timer& timer, std::uint32_t now) {
+    const auto deadline = timer.deadline.load(std::memory_order_relaxed);
+    const auto delta = static_cast<std::int32_t>(deadline - now);
+
+    std::size_t level = 0;
+    std::size_t index = slot_index(0, now);
+    if (delta > 0) {
+      while (level + 1 < kNumLevels &&
+             static_cast<std::uint32_t>(delta) >=
+                 (1u << (kSlotBits * (level + 1)))) {
+        level++;
+      }
+      index = slot_index(level, deadline);
+    }
+
+    Timer*& head = slots_[level][index];
+    timer.slot_next = head;
+    if (head != nullptr) {
+      head->slot_link = &timer.slot_next;
+    }
+    timer.slot_link = &head;
+    head = &timer;
+  }
+
+  static void unlink(Timer& timer) {
+    if (timer.slot_link == nullptr) {
+      return;
+    }
+    *timer.slot_link = timer.slot_next;
+    if (timer.slot_next != nullptr) {
+      timer.slot_next->slot_link = timer.slot_link;
+    }
+    timer.slot_next = nullptr;
+    timer.slot_link = nullptr;
+  }
+
+  std::atomic<std::uint32_t> now_{0};
+  IntrusiveLifo<Timer> pending_;
+  // Only accessed from tick()
+  std::array<std::array<Timer*, kNumSlots>, kNumLevels> slots_{};
+};
+
+}  // namespace cortex_m_atomics
@@ -23,89 +23,149 @@
  */
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 
-// Type traits that check if an action returns void
-template <class Action, class... Args>
-using returns_void = std::is_void<std::result_of_t<Action(Args...)>>;
+#include "cortex_m_atomics/critical_section.h"
+#include "dispatch.h"
+#include "fetch_op.h"
 
-template <class Action, class... Args>
-inline constexpr bool returns_void_v = returns_void<Action, Args...>::value;
+using cortex_m_atomics::critical_section;
+using cortex_m_atomics::memory_barrier;
+using cortex_m_atomics::preemption_point;
 
-/*
- * @brief Gets the state of the processors interrupt mask. This is 1 if
- * interrupts are masked. 0 otherwise.
+/**
+ * @brief Checks if a value of type T at ptr can be accessed with plain ldr and
+ * str instructions. 64 bit values are accessed as two words, so they only need
+ * word alignment. With CORTEX_M_ATOMICS_ALIGNED_ONLY every atomic is assumed
+ * to be aligned, which removes the check and the unaligned paths.
  */
-inline auto get_interrupt_mask() -> bool {
-  std::uint32_t primask;
-  asm volatile("mrs %0, primask" : "=r"(primask) :);
-  return primask != 0;
+template <class T>
+inline auto is_aligned([[maybe_unused]] const volatile void* ptr) -> bool {
+#if defined(CORTEX_M_ATOMICS_ALIGNED_ONLY)
+  return true;
+#else
+  constexpr std::uintptr_t alignment =
+      sizeof(T) < sizeof(std::uint32_t) ? sizeof(T) : sizeof(std::uint32_t);
+  return (reinterpret_cast<std::uintptr_t>(ptr) & (alignment - 1)) == 0;
+#endif
 }
 
 /**
- * @brief Runs some code within a critical section. Ensures that the interrupt
- * state is restored if it needed to disable interrupts.
+ * @brief Aligned access of the atomic loads, a single ldr. In the host backend
+ * it goes through the model checker, which may reorder it.
  */
-template <class Action, std::enable_if_t<std::is_invocable_v<Action> &&
-                                             !returns_void_v<Action>,
-                                         bool> = false>
-inline auto critical_section(Action action) {
-  const auto previously_enabled = get_interrupt_mask() == 0;
-  // Disable interrupts only if they were actually enabled. Otherwise there is
-  // no harm done, as they are already disabled
-  if (previously_enabled) {
-    asm volatile("cpsid i");
-  }
+template <class T>
+inline T load_aligned(const volatile void* ptr) {
+#if defined(CORTEX_M_ATOMICS_HOST)
+  return static_cast<T>(cortex_m_atomics::host::load(ptr, sizeof(T)));
+#else
+  return *reinterpret_cast<const volatile T*>(ptr);
+#endif
+}
 
-  // We execute the action in the critical section and capture the return value
-  const auto retval = action();
+/**
+ * @brief Aligned access of the atomic stores, a single str.
+ */
+template <class T>
+inline void store_aligned(volatile void* ptr, T value) {
+#if defined(CORTEX_M_ATOMICS_HOST)
+  cortex_m_atomics::host::store(ptr, value, sizeof(T));
+#else
+  *reinterpret_cast<volatile T*>(ptr) = value;
+#endif
+}
 
-  // We reenable interrupts if we disabled them, otherwise someone else must
-  // already be relying on them being disabled, so it is not safe to reenable
-  // them at this point. no harm done, as they are already disabled
-  if (previously_enabled) {
-    asm volatile("cpsie i");
+/**
+ * @brief Reads a value one byte at a time. Used for unaligned addresses, which
+ * fault on armv6-m. Interrupts must be masked, since the bytes are read
+ * separately.
+ */
+template <class T>
+inline T read_bytes(const volatile void* ptr) {
+  const auto* src = static_cast<const volatile std::uint8_t*>(ptr);
+  std::uint8_t bytes[sizeof(T)];
+  for (std::size_t i = 0; i < sizeof(T); i++) {
+    bytes[i] = src[i];
   }
-  return retval;
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
 }
 
 /**
- * @brief Runs some code within a critical section. Ensures that the interrupt
- * state is restored if it needed to disable interrupts.
- *
- * This verision of
+ * @brief Writes a value one byte at a time. Interrupts must be masked, since
+ * the bytes are written separately.
  */
-template <class Action, std::enable_if_t<std::is_invocable_v<Action> &&
-                                             returns_void_v<Action>,
-                                         bool> = false>
-inline auto critical_section(Action action) {
-  const auto previously_enabled = get_interrupt_mask() == 0;
-  // Disable interrupts only if they were actually enabled. Otherwise there is
-  // no harm done, as they are already disabled
-  if (previously_enabled) {
-    asm volatile("cpsid i");
+template <class T>
+inline void write_bytes(volatile void* ptr, T value) {
+  std::uint8_t bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  auto* dst = static_cast<volatile std::uint8_t*>(ptr);
+  for (std::size_t i = 0; i < sizeof(T); i++) {
+    dst[i] = bytes[i];
   }
+}
 
-  // We execute the action in the critical section
-  action();
-
-  // We reenable interrupts if we disabled them, otherwise someone else must
-  // already be relying on them being disabled, so it is not safe to reenable
-  // them at this point. no harm done, as they are already disabled
-  if (previously_enabled) {
-    asm volatile("cpsie i");
+/**
+ * @brief Reads the value at ptr, which may be unaligned. Must be called with
+ * interrupts masked.
+ */
+template <class T>
+inline T read_value(const volatile void* ptr) {
+  if (__builtin_expect(!is_aligned<T>(ptr), false)) {
+    return read_bytes<T>(ptr);
   }
+#if defined(CORTEX_M_ATOMICS_HOST)
+  return static_cast<T>(cortex_m_atomics::host::locked_load(ptr, sizeof(T)));
+#else
+  return *reinterpret_cast<const volatile T*>(ptr);
+#endif
 }
 
-inline void memory_barrier() { asm volatile("dmb"); }
+/**
+ * @brief Writes the value at ptr, which may be unaligned. Must be called with
+ * interrupts masked.
+ */
+template <class T>
+inline void write_value(volatile void* ptr, T value) {
+  if (__builtin_expect(!is_aligned<T>(ptr), false)) {
+    write_bytes(ptr, value);
+    return;
+  }
+#if defined(CORTEX_M_ATOMICS_HOST)
+  cortex_m_atomics::host::locked_store(ptr, value, sizeof(T));
+#else
+  *reinterpret_cast<volatile T*>(ptr) = value;
+#endif
+}
 
 template <class T>
 inline void atomic_store(volatile void* ptr, T value, std::memory_order order) {
+  preemption_point();
+  // Release: earlier accesses must be visible before the store. Forbids the
+  // message passing (MP) outcome where a reader sees the flag but stale data
   if (order != std::memory_order_relaxed) {
     memory_barrier();
   }
-  *reinterpret_cast<volatile T*>(ptr) = value;
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  // A plain store could land in the middle of a read-modify-write operation
+  // of another core, which would then overwrite it
+  critical_section([&]() { write_value(ptr, value); });
+#else
+  // Aligned stores are a single str. Unaligned ones are split in bytes, which
+  // must not be interleaved with other accesses to the same location
+  if (__builtin_expect(is_aligned<T>(ptr), true)) {
+    store_aligned(ptr, value);
+  } else {
+    critical_section([&]() { write_bytes(ptr, value); });
+  }
+#endif
+  // Sequential consistency: a later seq_cst load must not be satisfied before
+  // the store is visible. Forbids the store buffering (SB) outcome where two
+  // contexts each store a flag and both read the other flag as unset
   switch (order) {
     case std::memory_order_seq_cst:
     case std::memory_order_acq_rel:
@@ -115,6 +175,22 @@ inline void atomic_store(volatile void* ptr, T value, std::memory_order order) {
     default:
       break;
   }
+  preemption_point();
+}
+
+template <class T>
+inline void dispatch_store(volatile void* ptr, T value, int order) {
+  const auto memory_order = static_cast<std::memory_order>(order);
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+  // Relaxed stores are a plain str on every backend, so they skip the table.
+  // Unaligned addresses fault with the lock-free backends, so they also take
+  // the PRIMASK path
+  if (memory_order != std::memory_order_relaxed && is_aligned<T>(ptr)) {
+    dispatch_ops<T>().store(ptr, value, memory_order);
+    return;
+  }
+#endif
+  atomic_store(ptr, value, memory_order);
 }
 
 extern "C" void __atomic_store_8(volatile void* ptr, uint64_t value,
@@ -126,20 +202,25 @@ extern "C" void __atomic_store_8(volatile void* ptr, uint64_t value,
 
 extern "C" void __atomic_store_4(volatile void* ptr, unsigned int value,
                                  int order) {
-  atomic_store(ptr, value, static_cast<std::memory_order>(order));
+  dispatch_store(ptr, value, order);
 }
 
 extern "C" void __atomic_store_2(volatile void* ptr, uint16_t value,
                                  int order) {
-  atomic_store(ptr, value, static_cast<std::memory_order>(order));
+  dispatch_store(ptr, value, order);
 }
 
 extern "C" void __atomic_store_1(volatile void* ptr, uint8_t value, int order) {
-  atomic_store(ptr, value, static_cast<std::memory_order>(order));
+  dispatch_store(ptr, value, order);
 }
 
 template <class T>
 inline T atomic_load(const volatile void* ptr, std::memory_order order) {
+  preemption_point();
+  // Not required by C++: the trailing barrier of seq_cst stores already
+  // forbids SB when both sides are seq_cst. Kept so that a seq_cst load is
+  // also ordered after an earlier release store, which code written against
+  // older versions of this library may rely on
   switch (order) {
     case std::memory_order_seq_cst:
     case std::memory_order_acq_rel:
@@ -149,13 +230,38 @@ inline T atomic_load(const volatile void* ptr, std::memory_order order) {
     default:
       break;
   }
-  T value = *reinterpret_cast<const volatile T*>(ptr);
+  T value;
+  // Aligned loads are a single ldr. Unaligned ones are split in bytes, which
+  // must not be interleaved with other accesses to the same location
+  if (__builtin_expect(is_aligned<T>(ptr), true)) {
+    value = load_aligned<T>(ptr);
+  } else {
+    value = critical_section([&]() { return read_bytes<T>(ptr); });
+  }
+  // Acquire: later accesses must not be performed before the load. Forbids
+  // the MP outcome on the reader side, and the load buffering (LB) outcome
+  // where each context reads the value stored later by the other one
   if (order != std::memory_order_relaxed) {
     memory_barrier();
   }
+  preemption_point();
   return value;
 }
 
+template <class T>
+inline T dispatch_load(const volatile void* ptr, int order) {
+  const auto memory_order = static_cast<std::memory_order>(order);
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+  // Relaxed loads are a plain ldr on every backend, so they skip the table.
+  // Unaligned addresses fault with the lock-free backends, so they also take
+  // the PRIMASK path
+  if (memory_order != std::memory_order_relaxed && is_aligned<T>(ptr)) {
+    return dispatch_ops<T>().load(ptr, memory_order);
+  }
+#endif
+  return atomic_load<T>(ptr, memory_order);
+}
+
 extern "C" uint64_t __atomic_load_8(const volatile void* ptr, int order) {
   const auto value = critical_section([&]() {
     return atomic_load<uint64_t>(ptr, static_cast<std::memory_order>(order));
@@ -164,26 +270,31 @@ extern "C" uint64_t __atomic_load_8(const volatile void* ptr, int order) {
 }
 
 extern "C" unsigned int __atomic_load_4(const volatile void* ptr, int order) {
-  return atomic_load<uint32_t>(ptr, static_cast<std::memory_order>(order));
+  return dispatch_load<unsigned int>(ptr, order);
 }
 
 extern "C" uint16_t __atomic_load_2(const volatile void* ptr, int order) {
-  return atomic_load<uint16_t>(ptr, static_cast<std::memory_order>(order));
+  return dispatch_load<uint16_t>(ptr, order);
 }
 
 extern "C" uint8_t __atomic_load_1(const volatile void* ptr, int order) {
-  return atomic_load<uint8_t>(ptr, static_cast<std::memory_order>(order));
+  return dispatch_load<uint8_t>(ptr, order);
 }
 
 template <class T>
 T atomic_exchange(volatile void* ptr, T value, std::memory_order order) {
+  // The exit is a preemption point too, since interrupts are unmasked there
+  preemption_point();
   return critical_section([&]() {
+    // Release half: MP on the writer side
     if (order != std::memory_order_relaxed) {
       memory_barrier();
     }
-    auto& atomic = *reinterpret_cast<volatile T*>(ptr);
-    const auto prev_val = atomic;
-    atomic = value;
+    const auto prev_val = read_value<T>(ptr);
+    write_value(ptr, value);
+    // Acquire half: MP on the reader side and LB. Together with the leading
+    // barrier it also forbids SB and IRIW, where two readers observe two
+    // independent writes in different orders, for seq_cst
     if (order != std::memory_order_relaxed) {
       memory_barrier();
     }
@@ -191,6 +302,18 @@ T atomic_exchange(volatile void* ptr, T value, std::memory_order order) {
   });
 }
 
+template <class T>
+inline T dispatch_exchange(volatile void* ptr, T value, int order) {
+  const auto memory_order = static_cast<std::memory_order>(order);
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+  // Exclusive accesses fault on unaligned addresses
+  if (is_aligned<T>(ptr)) {
+    return dispatch_ops<T>().exchange(ptr, value, memory_order);
+  }
+#endif
+  return atomic_exchange(ptr, value, memory_order);
+}
+
 extern "C" uint64_t __atomic_exchange_8(volatile void* ptr, uint64_t value,
                                         int order) {
   return atomic_exchange(ptr, value, static_cast<std::memory_order>(order));
@@ -198,55 +321,222 @@ extern "C" uint64_t __atomic_exchange_8(volatile void* ptr, uint64_t value,
 
 extern "C" unsigned int __atomic_exchange_4(volatile void* ptr,
                                             unsigned int value, int order) {
-  return atomic_exchange(ptr, value, static_cast<std::memory_order>(order));
+  return dispatch_exchange(ptr, value, order);
 }
 
 extern "C" uint16_t __atomic_exchange_2(volatile void* ptr, uint16_t value,
                                         int order) {
-  return atomic_exchange(ptr, value, static_cast<std::memory_order>(order));
+  return dispatch_exchange(ptr, value, order);
 }
 
 extern "C" uint8_t __atomic_exchange_1(volatile void* ptr, uint8_t value,
                                        int order) {
-  return atomic_exchange(ptr, value, static_cast<std::memory_order>(order));
+  return dispatch_exchange(ptr, value, order);
 }
 
 template <class T>
-T atomic_fetch_add(volatile void* ptr, const T value, std::memory_order order) {
+bool atomic_compare_exchange(volatile void* ptr, void* expected, T desired,
+                             std::memory_order success,
+                             std::memory_order failure) {
+  preemption_point();
+  return critical_section([&]() {
+    if (success != std::memory_order_relaxed) {
+      // Release half, as in atomic_exchange(). The failure order cannot be
+      // stronger than the success order, so the leading barrier only depends
+      // on the latter
+      memory_barrier();
+    }
+    auto& expected_value = *static_cast<T*>(expected);
+    const auto current_value = read_value<T>(ptr);
+    const bool equal = current_value == expected_value;
+    if (equal) {
+      write_value(ptr, desired);
+    } else {
+      expected_value = current_value;
+    }
+    // Acquire half, as in atomic_exchange(). A failed compare exchange is a
+    // load, which still needs it to forbid MP when the failure order is not
+    // relaxed
+    if ((equal ? success : failure) != std::memory_order_relaxed) {
+      memory_barrier();
+    }
+    return equal;
+  });
+}
+
+template <class T>
+inline bool dispatch_compare_exchange(volatile void* ptr, void* expected,
+                                      T desired, int success, int failure) {
+  const auto success_order = static_cast<std::memory_order>(success);
+  const auto failure_order = static_cast<std::memory_order>(failure);
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+  // Exclusive accesses fault on unaligned addresses
+  if (is_aligned<T>(ptr)) {
+    return dispatch_ops<T>().compare_exchange(ptr, expected, desired,
+                                              success_order, failure_order);
+  }
+#endif
+  return atomic_compare_exchange(ptr, expected, desired, success_order,
+                                 failure_order);
+}
+
+// GCC declares the compare exchange intrinsics as builtins with an additional
+// `weak` argument, which is not part of the library ABI. They are defined with
+// a different name and renamed with an asm label instead.
+extern "C" bool atomic_compare_exchange_8(volatile void* ptr, void* expected,
+                                          uint64_t desired, int success,
+                                          int failure)
+    asm("__atomic_compare_exchange_8");
+extern "C" bool atomic_compare_exchange_4(volatile void* ptr, void* expected,
+                                          unsigned int desired, int success,
+                                          int failure)
+    asm("__atomic_compare_exchange_4");
+extern "C" bool atomic_compare_exchange_2(volatile void* ptr, void* expected,
+                                          uint16_t desired, int success,
+                                          int failure)
+    asm("__atomic_compare_exchange_2");
+extern "C" bool atomic_compare_exchange_1(volatile void* ptr, void* expected,
+                                          uint8_t desired, int success,
+                                          int failure)
+    asm("__atomic_compare_exchange_1");
+
+extern "C" bool atomic_compare_exchange_8(volatile void* ptr, void* expected,
+                                          uint64_t desired, int success,
+                                          int failure) {
+  return atomic_compare_exchange(ptr, expected, desired,
+                                 static_cast<std::memory_order>(success),
+                                 static_cast<std::memory_order>(failure));
+}
+
+extern "C" bool atomic_compare_exchange_4(volatile void* ptr, void* expected,
+                                          unsigned int desired, int success,
+                                          int failure) {
+  return dispatch_compare_exchange(ptr, expected, desired, success, failure);
+}
+
+extern "C" bool atomic_compare_exchange_2(volatile void* ptr, void* expected,
+                                          uint16_t desired, int success,
+                                          int failure) {
+  return dispatch_compare_exchange(ptr, expected, desired, success, failure);
+}
+
+extern "C" bool atomic_compare_exchange_1(volatile void* ptr, void* expected,
+                                          uint8_t desired, int success,
+                                          int failure) {
+  return dispatch_compare_exchange(ptr, expected, desired, success, failure);
+}
+
+template <FetchOp kOp, class T>
+T atomic_fetch_op(volatile void* ptr, const T value, std::memory_order order) {
+  preemption_point();
   return critical_section([&]() {
+    // Same barriers as atomic_exchange(). A release operation only needs the
+    // leading one and an acquire operation only the trailing one, which is
+    // not exploited yet
     if (order != std::memory_order_relaxed) {
-      // this is a bit more pessimistic than needed, but shall do
       memory_barrier();
     }
-    volatile T& atomic = *reinterpret_cast<volatile T*>(ptr);
-    const auto prev_value = atomic;
-    atomic = prev_value + value;
+    const auto prev_value = read_value<T>(ptr);
+    write_value(ptr, apply_fetch_op<kOp>(prev_value, value));
     if (order != std::memory_order_relaxed) {
-      // this is a bit more pessimistic than needed, but shall do
       memory_barrier();
     }
     return prev_value;
   });
 }
 
-extern "C" uint64_t __atomic_fetch_add_8(volatile void* ptr,
-                                         const uint64_t value,
-                                         const int order) {
-  return atomic_fetch_add(ptr, value, static_cast<std::memory_order>(order));
+template <FetchOp kOp, class T>
+inline T dispatch_fetch_op(volatile void* ptr, T value, int order) {
+  const auto memory_order = static_cast<std::memory_order>(order);
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+  // Exclusive accesses fault on unaligned addresses
+  if (is_aligned<T>(ptr)) {
+    return dispatch_ops<T>().fetch_op[kOp](ptr, value, memory_order);
+  }
+#endif
+  return atomic_fetch_op<kOp>(ptr, value, memory_order);
 }
 
-extern "C" unsigned int __atomic_fetch_add_4(volatile void* ptr,
-                                             const unsigned int value,
-                                             int order) {
-  return atomic_fetch_add(ptr, value, static_cast<std::memory_order>(order));
-}
+// Defines __atomic_fetch_<name>_N, which return the previous value, and
+// __atomic_<name>_fetch_N, which return the new one, for every size.
+#define DEFINE_FETCH_OP(name, op)                                            \
+  extern "C" uint64_t __atomic_fetch_##name##_8(volatile void* ptr,          \
+                                                uint64_t value, int order) { \
+    return atomic_fetch_op<op>(ptr, value,                                   \
+                               static_cast<std::memory_order>(order));       \
+  }                                                                          \
+                                                                             \
+  extern "C" unsigned int __atomic_fetch_##name##_4(                         \
+      volatile void* ptr, unsigned int value, int order) {                   \
+    return dispatch_fetch_op<op>(ptr, value, order);                         \
+  }                                                                          \
+                                                                             \
+  extern "C" uint16_t __atomic_fetch_##name##_2(volatile void* ptr,          \
+                                                uint16_t value, int order) { \
+    return dispatch_fetch_op<op>(ptr, value, order);                         \
+  }                                                                          \
+                                                                             \
+  extern "C" uint8_t __atomic_fetch_##name##_1(volatile void* ptr,           \
+                                               uint8_t value, int order) {   \
+    return dispatch_fetch_op<op>(ptr, value, order);                         \
+  }                                                                          \
+                                                                             \
+  extern "C" uint64_t __atomic_##name##_fetch_8(volatile void* ptr,          \
+                                                uint64_t value, int order) { \
+    return apply_fetch_op<op>(__atomic_fetch_##name##_8(ptr, value, order),  \
+                              value);                                        \
+  }                                                                          \
+                                                                             \
+  extern "C" unsigned int __atomic_##name##_fetch_4(                         \
+      volatile void* ptr, unsigned int value, int order) {                   \
+    return apply_fetch_op<op>(__atomic_fetch_##name##_4(ptr, value, order),  \
+                              value);                                        \
+  }                                                                          \
+                                                                             \
+  extern "C" uint16_t __atomic_##name##_fetch_2(volatile void* ptr,          \
+                                                uint16_t value, int order) { \
+    return apply_fetch_op<op>(__atomic_fetch_##name##_2(ptr, value, order),  \
+                              value);                                        \
+  }                                                                          \
+                                                                             \
+  extern "C" uint8_t __atomic_##name##_fetch_1(volatile void* ptr,           \
+                                               uint8_t value, int order) {   \
+    return apply_fetch_op<op>(__atomic_fetch_##name##_1(ptr, value, order),  \
+                              value);                                        \
+  }
 
-extern "C" uint16_t __atomic_fetch_add_2(volatile void* ptr, uint16_t value,
-                                         int order) {
-  return atomic_fetch_add(ptr, value, static_cast<std::memory_order>(order));
-}
+DEFINE_FETCH_OP(add, kFetchAdd)
+DEFINE_FETCH_OP(sub, kFetchSub)
+DEFINE_FETCH_OP(and, kFetchAnd)
+DEFINE_FETCH_OP(or, kFetchOr)
+DEFINE_FETCH_OP(xor, kFetchXor)
 
-extern "C" uint8_t __atomic_fetch_add_1(volatile void* ptr, uint8_t value,
-                                        int order) {
-  return atomic_fetch_add(ptr, value, static_cast<std::memory_order>(order));
+#undef DEFINE_FETCH_OP
+
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+template <class T>
+constexpr auto primask_ops() -> AtomicOps<T> {
+  return {
+      atomic_load<T>,
+      atomic_store<T>,
+      atomic_exchange<T>,
+      atomic_compare_exchange<T>,
+      {
+          atomic_fetch_op<kFetchAdd, T>,
+          atomic_fetch_op<kFetchSub, T>,
+          atomic_fetch_op<kFetchAnd, T>,
+          atomic_fetch_op<kFetchOr, T>,
+          atomic_fetch_op<kFetchXor, T>,
+      },
+  };
 }
+
+constexpr DispatchTable kPrimaskTable = {
+    primask_ops<uint8_t>(),
+    primask_ops<uint16_t>(),
+    primask_ops<unsigned int>(),
+};
+
+const DispatchTable g_primask_table = kPrimaskTable;
+DispatchTable g_dispatch_table = kPrimaskTable;
+#endif
@@ -0,0 +1,406 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Atomic intrinsics for ARM Linux user space, selected with
+ * CORTEX_M_ATOMICS_LINUX_KUSER instead of src/atomic.cpp.
+ *
+ * cpsid is privileged, so interrupts cannot be masked. Every operation is
+ * built on a compare and swap of an aligned word: ldrex/strex on cores that
+ * have them and the kernel __kuser_cmpxchg helper on the others, which the
+ * kernel implements correctly for the core it runs on. 1 and 2 byte operations
+ * swap the word containing them. 8 byte operations use ldrexd/strexd or
+ * __kuser_cmpxchg64, which needs Linux 3.1 or newer. On older kernels, which
+ * report a __kuser_helper_version below 5, they take a global spinlock built
+ * on __kuser_cmpxchg instead.
+ *
+ * Read-modify-write operations are always sequentially consistent. Like
+ * __kuser_cmpxchg, they are surrounded by barriers.
+ */
+
+#if !defined(__linux__) || !defined(__arm__)
+#error "The kuser helpers backend is only available on ARM Linux"
+#endif
+
+#include <sched.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fetch_op.h"
+
+namespace {
+
+// Fixed addresses of the helpers in the vector page. See
+// Documentation/arm/kernel_user_helpers.rst in the Linux sources.
+using KuserCmpxchg = int (*)(std::int32_t oldval, std::int32_t newval,
+                             volatile std::int32_t* ptr);
+using KuserMemoryBarrier = void (*)();
+using KuserCmpxchg64 = int (*)(const std::int64_t* oldval,
+                               const std::int64_t* newval,
+                               volatile std::int64_t* ptr);
+
+constexpr std::uintptr_t kKuserCmpxchg64Address = 0xffff0f60;
+constexpr std::uintptr_t kKuserMemoryBarrierAddress = 0xffff0fa0;
+constexpr std::uintptr_t kKuserCmpxchgAddress = 0xffff0fc0;
+constexpr std::uintptr_t kKuserHelperVersionAddress = 0xffff0ffc;
+
+// First __kuser_helper_version with __kuser_cmpxchg64
+constexpr std::int32_t kKuserCmpxchg64Version = 5;
+
+inline void memory_barrier() {
+  reinterpret_cast<KuserMemoryBarrier>(kKuserMemoryBarrierAddress)();
+}
+
+/**
+ * @brief Replaces the word at ptr with desired if it holds expected. Returns
+ * true on success.
+ */
+inline auto swap_word(volatile std::uint32_t* ptr, std::uint32_t expected,
+                      std::uint32_t desired) -> bool {
+#if defined(__ARM_FEATURE_LDREX) && (__ARM_FEATURE_LDREX & 4)
+  memory_barrier();
+  std::uint32_t current;
+  std::uint32_t failed;
+  do {
+    asm volatile("ldrex %0, [%1]" : "=&r"(current) : "r"(ptr) : "memory");
+    if (current != expected) {
+      asm volatile("clrex" : : : "memory");
+      break;
+    }
+    asm volatile("strex %0, %2, [%1]"
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(desired)
+                 : "memory");
+  } while (failed != 0);
+  memory_barrier();
+  return current == expected;
+#else
+  return reinterpret_cast<KuserCmpxchg>(kKuserCmpxchgAddress)(
+             static_cast<std::int32_t>(expected),
+             static_cast<std::int32_t>(desired),
+             reinterpret_cast<volatile std::int32_t*>(ptr)) == 0;
+#endif
+}
+
+#if !defined(__ARM_FEATURE_LDREX) || !(__ARM_FEATURE_LDREX & 8)
+/**
+ * @brief Whether the kernel provides __kuser_cmpxchg64. Jumping to its address
+ * on an older kernel executes whatever the vector page holds there.
+ */
+inline auto has_kuser_cmpxchg64() -> bool {
+  // A 0 until the first 8 byte operation reads the version. Racing readers
+  // all store the same value
+  static volatile std::int32_t version = 0;
+  if (version == 0) {
+    version = *reinterpret_cast<const volatile std::int32_t*>(
+        kKuserHelperVersionAddress);
+  }
+  return version >= kKuserCmpxchg64Version;
+}
+
+// Serialises the 8 byte operations on kernels without __kuser_cmpxchg64
+volatile std::int32_t g_double_word_lock = 0;
+
+void lock_double_words() {
+  while (reinterpret_cast<KuserCmpxchg>(kKuserCmpxchgAddress)(
+             0, 1, &g_double_word_lock) != 0) {
+    sched_yield();
+  }
+}
+
+void unlock_double_words() {
+  memory_barrier();
+  g_double_word_lock = 0;
+}
+#endif
+
+/**
+ * @brief Replaces the double word at ptr with desired if it holds expected.
+ * Returns true on success.
+ */
+inline auto swap_double_word(volatile std::uint64_t* ptr,
+                             std::uint64_t expected, std::uint64_t desired)
+    -> bool {
+#if defined(__ARM_FEATURE_LDREX) && (__ARM_FEATURE_LDREX & 8)
+  memory_barrier();
+  std::uint64_t current;
+  std::uint32_t failed;
+  do {
+    asm volatile("ldrexd %0, %H0, [%1]"
+                 : "=&r"(current)
+                 : "r"(ptr)
+                 : "memory");
+    if (current != expected) {
+      asm volatile("clrex" : : : "memory");
+      break;
+    }
+    asm volatile("strexd %0, %2, %H2, [%1]"
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(desired)
+                 : "memory");
+  } while (failed != 0);
+  memory_barrier();
+  return current == expected;
+#else
+  if (!has_kuser_cmpxchg64()) {
+    // Every 8 byte access goes through here, so the lock makes it atomic
+    lock_double_words();
+    const bool equal = *ptr == expected;
+    if (equal) {
+      *ptr = desired;
+    }
+    unlock_double_words();
+    return equal;
+  }
+
+  const auto old_value = static_cast<std::int64_t>(expected);
+  const auto new_value = static_cast<std::int64_t>(desired);
+  return reinterpret_cast<KuserCmpxchg64>(kKuserCmpxchg64Address)(
+             &old_value, &new_value,
+             reinterpret_cast<volatile std::int64_t*>(ptr)) == 0;
+#endif
+}
+
+/**
+ * @brief Bit offset of a 1 or 2 byte value within its aligned word.
+ */
+template <class T>
+inline auto shift_in_word(std::uintptr_t address) -> unsigned {
+  const auto offset = address & (sizeof(std::uint32_t) - 1);
+#if defined(__ARMEB__)
+  return (sizeof(std::uint32_t) - sizeof(T) - offset) * 8;
+#else
+  return offset * 8;
+#endif
+}
+
+/**
+ * @brief Replaces the value at ptr with desired if it holds expected. Returns
+ * true on success. Never fails spuriously.
+ */
+template <class T>
+inline auto try_swap(volatile void* ptr, T expected, T desired) -> bool {
+  if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+    return swap_double_word(static_cast<volatile std::uint64_t*>(ptr),
+                            expected, desired);
+  } else if constexpr (sizeof(T) == sizeof(std::uint32_t)) {
+    return swap_word(static_cast<volatile std::uint32_t*>(ptr), expected,
+                     desired);
+  } else {
+    const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+    auto* word = reinterpret_cast<volatile std::uint32_t*>(
+        address & ~(sizeof(std::uint32_t) - 1));
+    const auto shift = shift_in_word<T>(address);
+    const auto mask = static_cast<std::uint32_t>(static_cast<T>(~T{0}))
+                      << shift;
+    for (;;) {
+      const std::uint32_t current = *word;
+      if (static_cast<T>((current & mask) >> shift) != expected) {
+        return false;
+      }
+      const std::uint32_t replacement =
+          (current & ~mask) | (static_cast<std::uint32_t>(desired) << shift);
+      // Fails if other bytes of the word changed, in which case the value is
+      // checked again
+      if (swap_word(word, current, replacement)) {
+        return true;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Reads the value at ptr atomically. ldrd is not single-copy atomic
+ * without LPAE, so 8 byte values are read by swapping them with themselves.
+ */
+template <class T>
+inline auto read(const volatile void* ptr) -> T {
+  if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+    auto* mutable_ptr = const_cast<volatile void*>(ptr);
+    for (;;) {
+      const T value = *static_cast<const volatile T*>(ptr);
+      if (try_swap<T>(mutable_ptr, value, value)) {
+        return value;
+      }
+    }
+  } else {
+    return *static_cast<const volatile T*>(ptr);
+  }
+}
+
+template <class T>
+inline auto compare_exchange(volatile void* ptr, T expected, T desired) -> T {
+  for (;;) {
+    if (try_swap<T>(ptr, expected, desired)) {
+      return expected;
+    }
+    const T current = read<T>(ptr);
+    if (current != expected) {
+      return current;
+    }
+  }
+}
+
+template <class T>
+inline auto atomic_load(const volatile void* ptr, int order) -> T {
+  if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+    return read<T>(ptr);
+  } else {
+    if (order == __ATOMIC_SEQ_CST) {
+      memory_barrier();
+    }
+    const T value = read<T>(ptr);
+    if (order != __ATOMIC_RELAXED) {
+      memory_barrier();
+    }
+    return value;
+  }
+}
+
+template <class T>
+inline auto atomic_exchange(volatile void* ptr, T value) -> T {
+  T current = read<T>(ptr);
+  for (;;) {
+    const T previous = compare_exchange(ptr, current, value);
+    if (previous == current) {
+      return previous;
+    }
+    current = previous;
+  }
+}
+
+template <class T>
+inline void atomic_store(volatile void* ptr, T value, int order) {
+  if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+    atomic_exchange(ptr, value);
+  } else {
+    if (order != __ATOMIC_RELAXED) {
+      memory_barrier();
+    }
+    *static_cast<volatile T*>(ptr) = value;
+    if (order == __ATOMIC_SEQ_CST) {
+      memory_barrier();
+    }
+  }
+}
+
+template <FetchOp kOp, class T>
+inline auto atomic_fetch_op(volatile void* ptr, T value) -> T {
+  T current = read<T>(ptr);
+  for (;;) {
+    const T previous =
+        compare_exchange(ptr, current, apply_fetch_op<kOp>(current, value));
+    if (previous == current) {
+      return previous;
+    }
+    current = previous;
+  }
+}
+
+template <class T>
+inline auto atomic_compare_exchange(volatile void* ptr, void* expected,
+                                    T desired) -> bool {
+  auto& expected_value = *static_cast<T*>(expected);
+  const T previous = compare_exchange(ptr, expected_value, desired);
+  if (previous == expected_value) {
+    return true;
+  }
+  expected_value = previous;
+  return false;
+}
+
+}  // namespace
+
+// Defines the load, store and exchange intrinsics of a size.
+#define DEFINE_ACCESS_OPS(size, type)                                      \
+  extern "C" type __atomic_load_##size(const volatile void* ptr,           \
+                                       int order) {                        \
+    return atomic_load<type>(ptr, order);                                  \
+  }                                                                        \
+                                                                           \
+  extern "C" void __atomic_store_##size(volatile void* ptr, type value,    \
+                                        int order) {                       \
+    atomic_store(ptr, value, order);                                       \
+  }                                                                        \
+                                                                           \
+  extern "C" type __atomic_exchange_##size(volatile void* ptr, type value, \
+                                           int) {                          \
+    return atomic_exchange(ptr, value);                                    \
+  }
+
+DEFINE_ACCESS_OPS(8, uint64_t)
+DEFINE_ACCESS_OPS(4, unsigned int)
+DEFINE_ACCESS_OPS(2, uint16_t)
+DEFINE_ACCESS_OPS(1, uint8_t)
+
+#undef DEFINE_ACCESS_OPS
+
+// GCC declares the compare exchange intrinsics as builtins with an additional
+// `weak` argument, which is not part of the library ABI. They are defined with
+// a different name and renamed with an asm label instead, as in
+// src/atomic.cpp.
+#define DEFINE_COMPARE_EXCHANGE(size, type)                          \
+  extern "C" bool atomic_compare_exchange_##size(                    \
+      volatile void* ptr, void* expected, type desired, int success, \
+      int failure) asm("__atomic_compare_exchange_" #size);          \
+                                                                     \
+  extern "C" bool atomic_compare_exchange_##size(                    \
+      volatile void* ptr, void* expected, type desired, int, int) {  \
+    return atomic_compare_exchange(ptr, expected, desired);          \
+  }
+
+DEFINE_COMPARE_EXCHANGE(8, uint64_t)
+DEFINE_COMPARE_EXCHANGE(4, unsigned int)
+DEFINE_COMPARE_EXCHANGE(2, uint16_t)
+DEFINE_COMPARE_EXCHANGE(1, uint8_t)
+
+#undef DEFINE_COMPARE_EXCHANGE
+
+// Defines __atomic_fetch_<name>_N and __atomic_<name>_fetch_N for a size.
+#define DEFINE_FETCH_OP(name, op, size, type)                          \
+  extern "C" type __atomic_fetch_##name##_##size(volatile void* ptr,   \
+                                                 type value, int) {    \
+    return atomic_fetch_op<op>(ptr, value);                            \
+  }                                                                    \
+                                                                       \
+  extern "C" type __atomic_##name##_fetch_##size(volatile void* ptr,   \
+                                                 type value, int) {    \
+    return apply_fetch_op<op>(atomic_fetch_op<op>(ptr, value), value); \
+  }
+
+#define DEFINE_FETCH_OPS(size, type)          \
+  DEFINE_FETCH_OP(add, kFetchAdd, size, type) \
+  DEFINE_FETCH_OP(sub, kFetchSub, size, type) \
+  DEFINE_FETCH_OP(and, kFetchAnd, size, type) \
+  DEFINE_FETCH_OP(or, kFetchOr, size, type)   \
+  DEFINE_FETCH_OP(xor, kFetchXor, size, type)
+
+DEFINE_FETCH_OPS(8, uint64_t)
+DEFINE_FETCH_OPS(4, unsigned int)
+DEFINE_FETCH_OPS(2, uint16_t)
+DEFINE_FETCH_OPS(1, uint8_t)
+
+#undef DEFINE_FETCH_OPS
+#undef DEFINE_FETCH_OP
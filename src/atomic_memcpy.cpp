@@ -0,0 +1,122 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cortex_m_atomics/memcpy.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "cortex_m_atomics/critical_section.h"
+
+using cortex_m_atomics::memory_barrier;
+
+namespace {
+
+constexpr std::size_t kBurstSize = 4 * sizeof(std::uint32_t);
+
+/**
+ * @brief Copies 16 bytes between word aligned buffers with a single ldm/stm
+ * pair, advancing both pointers. Aligned words are single-copy atomic, so
+ * every byte is copied atomically.
+ */
+inline void copy_burst(volatile std::uint8_t*& dest,
+                       const volatile std::uint8_t*& source) {
+  asm volatile(
+      "ldmia %[source]!, {r3, r4, r5, r6}\n"
+      "stmia %[dest]!, {r3, r4, r5, r6}"
+      : [source] "+l"(source), [dest] "+l"(dest)
+      :
+      : "r3", "r4", "r5", "r6", "memory");
+}
+
+/**
+ * @brief Copies bytes with relaxed, per-byte atomic accesses. Words and bursts
+ * are used when source and dest share their alignment. The accesses are
+ * volatile so that the compiler does not turn the loops into a memcpy call,
+ * which could read bytes more than once.
+ */
+void copy_relaxed(void* dest, const void* source, std::size_t count) {
+  auto* dst = static_cast<volatile std::uint8_t*>(dest);
+  auto* src = static_cast<const volatile std::uint8_t*>(source);
+
+  const auto misalignment = [](const volatile void* ptr) {
+    return reinterpret_cast<std::uintptr_t>(ptr) & (sizeof(std::uint32_t) - 1);
+  };
+
+  if (misalignment(dst) == misalignment(src)) {
+    while (count > 0 && misalignment(dst) != 0) {
+      *dst++ = *src++;
+      count--;
+    }
+
+    while (count >= kBurstSize) {
+      copy_burst(dst, src);
+      count -= kBurstSize;
+    }
+
+    while (count >= sizeof(std::uint32_t)) {
+      *reinterpret_cast<volatile std::uint32_t*>(dst) =
+          *reinterpret_cast<const volatile std::uint32_t*>(src);
+      dst += sizeof(std::uint32_t);
+      src += sizeof(std::uint32_t);
+      count -= sizeof(std::uint32_t);
+    }
+  }
+
+  while (count > 0) {
+    *dst++ = *src++;
+    count--;
+  }
+}
+
+}  // namespace
+
+namespace cortex_m_atomics {
+
+auto atomic_load_per_byte_memcpy(void* dest, const void* source,
+                                 std::size_t count, std::memory_order order)
+    -> void* {
+  copy_relaxed(dest, source, count);
+  // The copy must complete before any later access, e.g. the second read of a
+  // seqlock sequence number
+  if (order != std::memory_order_relaxed) {
+    memory_barrier();
+  }
+  return dest;
+}
+
+auto atomic_store_per_byte_memcpy(void* dest, const void* source,
+                                  std::size_t count, std::memory_order order)
+    -> void* {
+  // Earlier accesses, e.g. the seqlock sequence number update, must be
+  // visible before any byte of the copy
+  if (order != std::memory_order_relaxed) {
+    memory_barrier();
+  }
+  copy_relaxed(dest, source, count);
+  return dest;
+}
+
+}  // namespace cortex_m_atomics
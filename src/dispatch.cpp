@@ -0,0 +1,523 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cortex_m_atomics/dispatch.h"
+
+#if defined(CORTEX_M_ATOMICS_RUNTIME_DISPATCH)
+
+#include <atomic>
+#include <cstdint>
+
+#include "cortex_m_atomics/critical_section.h"
+#include "cortex_m_atomics/instrumentation.h"
+#include "dispatch.h"
+#include "fetch_op.h"
+
+#if !defined(__ARM_ARCH_6M__)
+#error "Runtime dispatch only makes sense for images built for armv6-m"
+#endif
+
+// Number of ldrex/strex attempts of a read-modify-write before it masks
+// interrupts. An interrupt that fires faster than the sequence can complete
+// clears the exclusive monitor every time, so without a bound the thread
+// could be starved forever. Also used by cortex_m_atomics/exclusive.h.
+#ifndef CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS
+#define CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS 4
+#endif
+
+namespace {
+
+using cortex_m_atomics::critical_section;
+using cortex_m_atomics::exclusive_sequence_end;
+using cortex_m_atomics::memory_barrier;
+
+constexpr std::uint32_t kExclusiveAttempts =
+    CORTEX_M_ATOMICS_EXCLUSIVE_ATTEMPTS;
+static_assert(kExclusiveAttempts > 0, "At least one attempt is needed");
+
+// The image is built for armv6-m, so the assembler has to be told that the
+// exclusive and acquire/release instructions are available for the
+// instructions of each backend. The architecture is restored afterwards.
+#define V7M_ASM(insn) ".arch armv7-m\n\t" insn "\n\t.arch armv6s-m"
+#define V8M_ASM(insn) ".arch armv8-m.base\n\t" insn "\n\t.arch armv6s-m"
+
+constexpr std::uintptr_t kCpuidAddress = 0xE000ED00;
+constexpr std::uint32_t kImplementerArm = 0x41;
+
+enum PartNumber : std::uint32_t {
+  kCortexM0 = 0xC20,
+  kCortexM1 = 0xC21,
+  kCortexM3 = 0xC23,
+  kCortexM4 = 0xC24,
+  kCortexM7 = 0xC27,
+  kCortexM0Plus = 0xC60,
+  kCortexM23 = 0xD20,
+  kCortexM33 = 0xD21,
+  kCortexM55 = 0xD22,
+  kCortexM85 = 0xD23,
+  kCortexM52 = 0xD24,
+  kCortexM35P = 0xD31,
+};
+
+cortex_m_atomics::Backend g_backend = cortex_m_atomics::Backend::kPrimask;
+
+inline auto is_acquire(std::memory_order order) -> bool {
+  return order != std::memory_order_relaxed &&
+         order != std::memory_order_release;
+}
+
+inline auto is_release(std::memory_order order) -> bool {
+  return order == std::memory_order_release ||
+         order == std::memory_order_acq_rel ||
+         order == std::memory_order_seq_cst;
+}
+
+template <class T>
+inline T load_exclusive(volatile void* ptr) {
+  std::uint32_t value;
+  if constexpr (sizeof(T) == 1) {
+    asm volatile(V7M_ASM("ldrexb %0, [%1]")
+                 : "=r"(value)
+                 : "r"(ptr)
+                 : "memory");
+  } else if constexpr (sizeof(T) == 2) {
+    asm volatile(V7M_ASM("ldrexh %0, [%1]")
+                 : "=r"(value)
+                 : "r"(ptr)
+                 : "memory");
+  } else {
+    asm volatile(V7M_ASM("ldrex %0, [%1]") : "=r"(value) : "r"(ptr) : "memory");
+  }
+  return static_cast<T>(value);
+}
+
+/**
+ * @brief Attempts to store a value with the exclusive monitor. Returns true if
+ * the store succeeded.
+ */
+template <class T>
+inline auto store_exclusive(volatile void* ptr, T value) -> bool {
+  std::uint32_t failed;
+  if constexpr (sizeof(T) == 1) {
+    asm volatile(V7M_ASM("strexb %0, %2, [%1]")
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(value)
+                 : "memory");
+  } else if constexpr (sizeof(T) == 2) {
+    asm volatile(V7M_ASM("strexh %0, %2, [%1]")
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(value)
+                 : "memory");
+  } else {
+    asm volatile(V7M_ASM("strex %0, %2, [%1]")
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(value)
+                 : "memory");
+  }
+  return failed == 0;
+}
+
+template <class T>
+inline T load_acquire_exclusive(volatile void* ptr) {
+  std::uint32_t value;
+  if constexpr (sizeof(T) == 1) {
+    asm volatile(V8M_ASM("ldaexb %0, [%1]")
+                 : "=r"(value)
+                 : "r"(ptr)
+                 : "memory");
+  } else if constexpr (sizeof(T) == 2) {
+    asm volatile(V8M_ASM("ldaexh %0, [%1]")
+                 : "=r"(value)
+                 : "r"(ptr)
+                 : "memory");
+  } else {
+    asm volatile(V8M_ASM("ldaex %0, [%1]") : "=r"(value) : "r"(ptr) : "memory");
+  }
+  return static_cast<T>(value);
+}
+
+template <class T>
+inline auto store_release_exclusive(volatile void* ptr, T value) -> bool {
+  std::uint32_t failed;
+  if constexpr (sizeof(T) == 1) {
+    asm volatile(V8M_ASM("stlexb %0, %2, [%1]")
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(value)
+                 : "memory");
+  } else if constexpr (sizeof(T) == 2) {
+    asm volatile(V8M_ASM("stlexh %0, %2, [%1]")
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(value)
+                 : "memory");
+  } else {
+    asm volatile(V8M_ASM("stlex %0, %2, [%1]")
+                 : "=&r"(failed)
+                 : "r"(ptr), "r"(value)
+                 : "memory");
+  }
+  return failed == 0;
+}
+
+template <class T>
+inline T load_acquire(const volatile void* ptr) {
+  std::uint32_t value;
+  if constexpr (sizeof(T) == 1) {
+    asm volatile(V8M_ASM("ldab %0, [%1]") : "=r"(value) : "r"(ptr) : "memory");
+  } else if constexpr (sizeof(T) == 2) {
+    asm volatile(V8M_ASM("ldah %0, [%1]") : "=r"(value) : "r"(ptr) : "memory");
+  } else {
+    asm volatile(V8M_ASM("lda %0, [%1]") : "=r"(value) : "r"(ptr) : "memory");
+  }
+  return static_cast<T>(value);
+}
+
+template <class T>
+inline void store_release(volatile void* ptr, T value) {
+  if constexpr (sizeof(T) == 1) {
+    asm volatile(V8M_ASM("stlb %1, [%0]") : : "r"(ptr), "r"(value) : "memory");
+  } else if constexpr (sizeof(T) == 2) {
+    asm volatile(V8M_ASM("stlh %1, [%0]") : : "r"(ptr), "r"(value) : "memory");
+  } else {
+    asm volatile(V8M_ASM("stl %1, [%0]") : : "r"(ptr), "r"(value) : "memory");
+  }
+}
+
+inline void clear_exclusive() { asm volatile(V7M_ASM("clrex") : : : "memory"); }
+
+/**
+ * @brief Calls attempt() until it returns true, at most kExclusiveAttempts
+ * times. Returns false if every attempt lost the exclusive monitor, in which
+ * case the caller completes the operation with masked_rmw() or
+ * masked_compare_exchange().
+ */
+template <class Attempt>
+inline auto bounded_exclusive(Attempt attempt) -> bool {
+  for (std::uint32_t retries = 0; retries < kExclusiveAttempts; retries++) {
+    if (attempt()) {
+      exclusive_sequence_end(retries, false);
+      return true;
+    }
+  }
+  exclusive_sequence_end(kExclusiveAttempts, true);
+  return false;
+}
+
+/**
+ * @brief Fallback of the exclusive read-modify-writes. The accesses stay
+ * exclusive, since another core may be running its own ldrex/strex sequence
+ * on the same location without taking any lock. With interrupts masked no
+ * exception can clear the monitor, so the loop only retries while another bus
+ * master writes the location.
+ */
+template <class T, class Modify>
+inline T masked_rmw(volatile void* ptr, Modify modify) {
+  return critical_section([&]() {
+    T prev_value;
+    do {
+      prev_value = load_exclusive<T>(ptr);
+    } while (!store_exclusive<T>(ptr, modify(prev_value)));
+    return prev_value;
+  });
+}
+
+template <class T>
+inline auto masked_compare_exchange(volatile void* ptr, T& expected_value,
+                                    T desired) -> bool {
+  return critical_section([&]() {
+    for (;;) {
+      const T current_value = load_exclusive<T>(ptr);
+      if (current_value != expected_value) {
+        clear_exclusive();
+        expected_value = current_value;
+        return false;
+      }
+      if (store_exclusive<T>(ptr, desired)) {
+        return true;
+      }
+    }
+  });
+}
+
+/**
+ * @brief Read-modify-write based on ldrex/strex for armv7-m cores. Exception
+ * entry and return clear the local monitor, so an interrupted sequence is
+ * retried, up to kExclusiveAttempts times before masking interrupts.
+ */
+template <class T, class Modify>
+inline T exclusive_rmw(volatile void* ptr, std::memory_order order,
+                       Modify modify) {
+  if (order != std::memory_order_relaxed) {
+    memory_barrier();
+  }
+  T prev_value;
+  const bool stored = bounded_exclusive([&]() {
+    prev_value = load_exclusive<T>(ptr);
+    return store_exclusive<T>(ptr, modify(prev_value));
+  });
+  if (!stored) {
+    prev_value = masked_rmw<T>(ptr, modify);
+  }
+  if (order != std::memory_order_relaxed) {
+    memory_barrier();
+  }
+  return prev_value;
+}
+
+/**
+ * @brief Read-modify-write based on the armv8-m acquire/release exclusives,
+ * which provide the ordering without any dmb.
+ */
+template <class T, class Modify>
+inline T acquire_release_rmw(volatile void* ptr, std::memory_order order,
+                             Modify modify) {
+  const bool acquire = is_acquire(order);
+  const bool release = is_release(order);
+  T prev_value;
+  const bool stored = bounded_exclusive([&]() {
+    prev_value =
+        acquire ? load_acquire_exclusive<T>(ptr) : load_exclusive<T>(ptr);
+    const T new_value = modify(prev_value);
+    return release ? store_release_exclusive<T>(ptr, new_value)
+                   : store_exclusive<T>(ptr, new_value);
+  });
+  if (!stored) {
+    // The fallback uses ldrex/strex, which need a dmb for the ordering
+    if (release) {
+      memory_barrier();
+    }
+    prev_value = masked_rmw<T>(ptr, modify);
+    if (acquire) {
+      memory_barrier();
+    }
+  }
+  return prev_value;
+}
+
+template <class T>
+T exclusive_exchange(volatile void* ptr, T value, std::memory_order order) {
+  return exclusive_rmw<T>(ptr, order, [value](T) { return value; });
+}
+
+template <FetchOp kOp, class T>
+T exclusive_fetch_op(volatile void* ptr, T value, std::memory_order order) {
+  return exclusive_rmw<T>(ptr, order, [value](T prev_value) {
+    return apply_fetch_op<kOp>(prev_value, value);
+  });
+}
+
+template <class T>
+bool exclusive_compare_exchange(volatile void* ptr, void* expected, T desired,
+                                std::memory_order success,
+                                std::memory_order failure) {
+  auto& expected_value = *static_cast<T*>(expected);
+  if (success != std::memory_order_relaxed) {
+    memory_barrier();
+  }
+  bool exchanged = false;
+  const bool completed = bounded_exclusive([&]() {
+    const T current_value = load_exclusive<T>(ptr);
+    if (current_value != expected_value) {
+      clear_exclusive();
+      expected_value = current_value;
+      return true;
+    }
+    exchanged = store_exclusive<T>(ptr, desired);
+    return exchanged;
+  });
+  if (!completed) {
+    exchanged = masked_compare_exchange<T>(ptr, expected_value, desired);
+  }
+  if ((exchanged ? success : failure) != std::memory_order_relaxed) {
+    memory_barrier();
+  }
+  return exchanged;
+}
+
+template <class T>
+T acquire_release_load(const volatile void* ptr, std::memory_order order) {
+  if (is_acquire(order) || is_release(order)) {
+    return load_acquire<T>(ptr);
+  }
+  return *reinterpret_cast<const volatile T*>(ptr);
+}
+
+template <class T>
+void acquire_release_store(volatile void* ptr, T value,
+                           std::memory_order order) {
+  if (order != std::memory_order_relaxed) {
+    store_release<T>(ptr, value);
+    return;
+  }
+  *reinterpret_cast<volatile T*>(ptr) = value;
+}
+
+template <class T>
+T acquire_release_exchange(volatile void* ptr, T value,
+                           std::memory_order order) {
+  return acquire_release_rmw<T>(ptr, order, [value](T) { return value; });
+}
+
+template <FetchOp kOp, class T>
+T acquire_release_fetch_op(volatile void* ptr, T value,
+                           std::memory_order order) {
+  return acquire_release_rmw<T>(ptr, order, [value](T prev_value) {
+    return apply_fetch_op<kOp>(prev_value, value);
+  });
+}
+
+template <class T>
+bool acquire_release_compare_exchange(volatile void* ptr, void* expected,
+                                      T desired, std::memory_order success,
+                                      std::memory_order failure) {
+  auto& expected_value = *static_cast<T*>(expected);
+  const bool acquire = is_acquire(success) || is_acquire(failure);
+  const bool release = is_release(success);
+  bool exchanged = false;
+  const bool completed = bounded_exclusive([&]() {
+    const T current_value =
+        acquire ? load_acquire_exclusive<T>(ptr) : load_exclusive<T>(ptr);
+    if (current_value != expected_value) {
+      clear_exclusive();
+      expected_value = current_value;
+      return true;
+    }
+    exchanged = release ? store_release_exclusive<T>(ptr, desired)
+                        : store_exclusive<T>(ptr, desired);
+    return exchanged;
+  });
+  if (!completed) {
+    // The fallback uses ldrex/strex, which need a dmb for the ordering
+    if (release) {
+      memory_barrier();
+    }
+    exchanged = masked_compare_exchange<T>(ptr, expected_value, desired);
+    if (acquire) {
+      memory_barrier();
+    }
+  }
+  return exchanged;
+}
+
+template <class T>
+auto exclusive_ops(const AtomicOps<T>& primask) -> AtomicOps<T> {
+  // Aligned loads and stores are single instructions on armv7-m as well, so
+  // only the read-modify-write operations change
+  return {
+      primask.load,
+      primask.store,
+      exclusive_exchange<T>,
+      exclusive_compare_exchange<T>,
+      {
+          exclusive_fetch_op<kFetchAdd, T>,
+          exclusive_fetch_op<kFetchSub, T>,
+          exclusive_fetch_op<kFetchAnd, T>,
+          exclusive_fetch_op<kFetchOr, T>,
+          exclusive_fetch_op<kFetchXor, T>,
+      },
+  };
+}
+
+template <class T>
+auto acquire_release_ops() -> AtomicOps<T> {
+  return {
+      acquire_release_load<T>,
+      acquire_release_store<T>,
+      acquire_release_exchange<T>,
+      acquire_release_compare_exchange<T>,
+      {
+          acquire_release_fetch_op<kFetchAdd, T>,
+          acquire_release_fetch_op<kFetchSub, T>,
+          acquire_release_fetch_op<kFetchAnd, T>,
+          acquire_release_fetch_op<kFetchOr, T>,
+          acquire_release_fetch_op<kFetchXor, T>,
+      },
+  };
+}
+
+auto detect_backend() -> cortex_m_atomics::Backend {
+  const auto cpuid = *reinterpret_cast<const volatile std::uint32_t*>(
+      kCpuidAddress);
+  const auto implementer = cpuid >> 24;
+  const auto part_number = (cpuid >> 4) & 0xFFF;
+
+  // Unknown cores keep the PRIMASK backend, which is correct everywhere
+  if (implementer != kImplementerArm) {
+    return cortex_m_atomics::Backend::kPrimask;
+  }
+
+  switch (part_number) {
+    case kCortexM3:
+    case kCortexM4:
+    case kCortexM7:
+      return cortex_m_atomics::Backend::kExclusive;
+    case kCortexM23:
+    case kCortexM33:
+    case kCortexM35P:
+    case kCortexM52:
+    case kCortexM55:
+    case kCortexM85:
+      return cortex_m_atomics::Backend::kAcquireRelease;
+    case kCortexM0:
+    case kCortexM0Plus:
+    case kCortexM1:
+    default:
+      return cortex_m_atomics::Backend::kPrimask;
+  }
+}
+
+}  // namespace
+
+namespace cortex_m_atomics {
+
+auto backend() -> Backend { return g_backend; }
+
+}  // namespace cortex_m_atomics
+
+extern "C" __attribute__((constructor)) void cortex_m_atomics_init() {
+  g_backend = detect_backend();
+
+  DispatchTable table = g_primask_table;
+  switch (g_backend) {
+    case cortex_m_atomics::Backend::kExclusive:
+      table.ops_1 = exclusive_ops(g_primask_table.ops_1);
+      table.ops_2 = exclusive_ops(g_primask_table.ops_2);
+      table.ops_4 = exclusive_ops(g_primask_table.ops_4);
+      break;
+    case cortex_m_atomics::Backend::kAcquireRelease:
+      table.ops_1 = acquire_release_ops<std::uint8_t>();
+      table.ops_2 = acquire_release_ops<std::uint16_t>();
+      table.ops_4 = acquire_release_ops<unsigned int>();
+      break;
+    case cortex_m_atomics::Backend::kPrimask:
+      break;
+  }
+
+  // Entries are word sized, so each of them is replaced atomically. Mixing
+  // backends while the table is being replaced is fine on a single core,
+  // since the PRIMASK window cannot be interrupted and exclusive sequences
+  // are retried after an exception.
+  g_dispatch_table = table;
+}
+
+#endif  // CORTEX_M_ATOMICS_RUNTIME_DISPATCH
@@ -0,0 +1,79 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "fetch_op.h"
+
+/**
+ * @brief Implementations of the atomic operations of a given size for one of
+ * the backends. Runtime dispatch binds the intrinsics to one of these.
+ */
+template <class T>
+struct AtomicOps {
+  T (*load)(const volatile void* ptr, std::memory_order order);
+  void (*store)(volatile void* ptr, T value, std::memory_order order);
+  T (*exchange)(volatile void* ptr, T value, std::memory_order order);
+  bool (*compare_exchange)(volatile void* ptr, void* expected, T desired,
+                           std::memory_order success,
+                           std::memory_order failure);
+  T (*fetch_op[kNumFetchOps])(volatile void* ptr, T value,
+                              std::memory_order order);
+};
+
+struct DispatchTable {
+  AtomicOps<std::uint8_t> ops_1;
+  AtomicOps<std::uint16_t> ops_2;
+  AtomicOps<unsigned int> ops_4;
+};
+
+/**
+ * @brief Table used by the intrinsics when runtime dispatch is enabled. It is
+ * statically initialized with the PRIMASK backend, which is correct on every
+ * core, so intrinsics can be used before cortex_m_atomics_init() runs.
+ */
+extern DispatchTable g_dispatch_table;
+
+/**
+ * @brief The PRIMASK implementation of the operations, defined in atomic.cpp.
+ */
+extern const DispatchTable g_primask_table;
+
+template <class T>
+inline auto dispatch_ops() -> const AtomicOps<T>& {
+  if constexpr (sizeof(T) == 1) {
+    static_assert(std::is_same_v<T, std::uint8_t>);
+    return g_dispatch_table.ops_1;
+  } else if constexpr (sizeof(T) == 2) {
+    static_assert(std::is_same_v<T, std::uint16_t>);
+    return g_dispatch_table.ops_2;
+  } else {
+    static_assert(std::is_same_v<T, unsigned int>);
+    return g_dispatch_table.ops_4;
+  }
+}
@@ -0,0 +1,60 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Operations implemented by the __atomic_fetch_<op>_N and
+ * __atomic_<op>_fetch_N intrinsics.
+ */
+enum FetchOp : std::size_t {
+  kFetchAdd,
+  kFetchSub,
+  kFetchAnd,
+  kFetchOr,
+  kFetchXor,
+  kNumFetchOps,
+};
+
+/**
+ * @brief Computes the value stored by a fetch operation from the previous
+ * value and the operand.
+ */
+template <FetchOp kOp, class T>
+constexpr T apply_fetch_op(T prev_value, T value) {
+  if constexpr (kOp == kFetchAdd) {
+    return static_cast<T>(prev_value + value);
+  } else if constexpr (kOp == kFetchSub) {
+    return static_cast<T>(prev_value - value);
+  } else if constexpr (kOp == kFetchAnd) {
+    return static_cast<T>(prev_value & value);
+  } else if constexpr (kOp == kFetchOr) {
+    return static_cast<T>(prev_value | value);
+  } else {
+    static_assert(kOp == kFetchXor);
+    return static_cast<T>(prev_value ^ value);
+  }
+}
@@ -0,0 +1,88 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cortex_m_atomics/instrumentation.h"
+
+#if defined(CORTEX_M_ATOMICS_INSTRUMENTATION)
+
+#include <cstdint>
+
+#include "cortex_m_atomics/critical_section.h"
+
+namespace {
+
+// Only accessed with interrupts masked and, on multi-core parts, the spinlock
+// of the cores held
+cortex_m_atomics::Statistics g_statistics{};
+
+}  // namespace
+
+extern "C" __attribute__((weak)) auto cortex_m_atomics_cycle_counter()
+    -> std::uint32_t {
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || \
+    defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__)
+  constexpr std::uintptr_t kDwtCyccntAddress = 0xE0001004;
+  return *reinterpret_cast<volatile std::uint32_t*>(kDwtCyccntAddress);
+#else
+  return 0;
+#endif
+}
+
+namespace cortex_m_atomics {
+
+auto statistics() -> Statistics {
+  return critical_section([]() { return g_statistics; });
+}
+
+void reset_statistics() {
+  critical_section([]() { g_statistics = Statistics{}; });
+}
+
+void record_masked_section(std::uint32_t start) {
+  const auto cycles = cortex_m_atomics_cycle_counter() - start;
+  g_statistics.masked_sections++;
+  if (cycles > g_statistics.max_masked_cycles) {
+    g_statistics.max_masked_cycles = cycles;
+  }
+}
+
+void record_exclusive_retries(std::uint32_t retries, bool fell_back) {
+  // Masks interrupts directly, so that the bookkeeping is not counted as a
+  // masked section itself
+  const bool previously_enabled = !get_interrupt_mask();
+  disable_interrupts();
+  multicore_lock();
+  g_statistics.exclusive_retries += retries;
+  if (fell_back) {
+    g_statistics.exclusive_fallbacks++;
+  }
+  multicore_unlock();
+  if (previously_enabled) {
+    enable_interrupts();
+  }
+}
+
+}  // namespace cortex_m_atomics
+
+#endif
@@ -0,0 +1,451 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cortex_m_atomics/model_checker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cortex_m_atomics/host.h"
+
+namespace cortex_m_atomics::host {
+
+namespace {
+
+// Bounds the length of an execution, so that programs that never terminate
+// fail instead of hanging
+constexpr std::size_t kMaxDecisions = 100000;
+
+struct Decision {
+  std::size_t choice;
+  std::size_t num_choices;
+};
+
+struct ExecutionFailed {
+  std::string message;
+};
+
+struct PendingStore {
+  std::uintptr_t address;
+  std::size_t size;
+  std::uint64_t value;
+};
+
+/**
+ * @brief State of the weak memory model for the thread or an ISR.
+ */
+struct Context {
+  // Stores that are not visible to the other contexts yet, in program order
+  std::vector<PendingStore> buffer;
+  // Oldest value of each location that the context may still load, as an
+  // index in the history of the location
+  std::map<std::uintptr_t, std::size_t> view;
+};
+
+struct State {
+  // Whether an execution is running
+  bool active = false;
+  bool primask = false;
+  // Set by wfi. The next preemption point must run an ISR
+  bool interrupt_pending = false;
+  // Index of the ISR that is running, or -1 in thread mode
+  int priority = -1;
+  const std::vector<ModelChecker::Function>* isrs = nullptr;
+  std::vector<bool> fired;
+  // Choices of the current schedule. Executions replay the prefix explored
+  // so far and extend it with the first choice
+  std::vector<Decision> decisions;
+  std::size_t depth = 0;
+  std::size_t points = 0;
+  std::string schedule;
+  // Weak memory model. Contexts are indexed by priority + 1
+  bool weak = false;
+  std::vector<Context> contexts;
+  // Values stored to each location that was accessed, oldest first
+  std::map<std::uintptr_t, std::vector<std::uint64_t>> history;
+};
+
+State g_state;
+
+auto eligible_isrs() -> std::vector<std::size_t> {
+  std::vector<std::size_t> eligible;
+  for (std::size_t isr = g_state.priority + 1; isr < g_state.fired.size();
+       isr++) {
+    if (!g_state.fired[isr]) {
+      eligible.push_back(isr);
+    }
+  }
+  return eligible;
+}
+
+auto choose(std::size_t num_choices) -> std::size_t {
+  if (g_state.depth == g_state.decisions.size()) {
+    if (g_state.decisions.size() == kMaxDecisions) {
+      throw ExecutionFailed{"too many preemption points"};
+    }
+    g_state.decisions.push_back({0, num_choices});
+  } else if (g_state.decisions[g_state.depth].num_choices != num_choices) {
+    throw ExecutionFailed{"the program is not deterministic"};
+  }
+  return g_state.decisions[g_state.depth++].choice;
+}
+
+void run_isr(std::size_t isr) {
+  g_state.fired[isr] = true;
+  g_state.interrupt_pending = false;
+  g_state.schedule += "  ISR " + std::to_string(isr) +
+                      " at preemption point " +
+                      std::to_string(g_state.points) + ", preempting " +
+                      (g_state.priority < 0
+                           ? std::string{"the thread\n"}
+                           : "ISR " + std::to_string(g_state.priority) + "\n");
+
+  const auto priority = g_state.priority;
+  g_state.priority = static_cast<int>(isr);
+  (*g_state.isrs)[isr]();
+  g_state.priority = priority;
+
+  // Exception return does not restore PRIMASK, so the preempted code would
+  // run with interrupts masked
+  if (g_state.primask) {
+    throw ExecutionFailed{"ISR " + std::to_string(isr) +
+                          " returned with interrupts masked"};
+  }
+}
+
+/**
+ * @brief Lets one of the eligible ISRs run, or none if an interrupt is not
+ * required to run.
+ */
+void schedule(bool must_run) {
+  const auto eligible = eligible_isrs();
+  if (eligible.empty()) {
+    return;
+  }
+
+  const auto num_choices = eligible.size() + (must_run ? 0 : 1);
+  auto choice = num_choices == 1 ? 0 : choose(num_choices);
+  if (!must_run) {
+    if (choice == 0) {
+      return;
+    }
+    choice--;
+  }
+  run_isr(eligible[choice]);
+}
+
+auto read_memory(std::uintptr_t address, std::size_t size) -> std::uint64_t {
+  std::uint64_t value = 0;
+  std::memcpy(&value, reinterpret_cast<const void*>(address), size);
+  return value;
+}
+
+void write_memory(std::uintptr_t address, std::uint64_t value,
+                  std::size_t size) {
+  std::memcpy(reinterpret_cast<void*>(address), &value, size);
+}
+
+auto is_weak() -> bool { return g_state.active && g_state.weak; }
+
+auto context_name(int priority) -> std::string {
+  return priority < 0 ? std::string{"thread"}
+                      : "ISR " + std::to_string(priority);
+}
+
+auto current_context() -> Context& {
+  return g_state.contexts[g_state.priority + 1];
+}
+
+auto history_of(std::uintptr_t address, std::size_t size)
+    -> std::vector<std::uint64_t>& {
+  auto& history = g_state.history[address];
+  if (history.empty()) {
+    history.push_back(read_memory(address, size));
+  }
+  return history;
+}
+
+/**
+ * @brief Makes a store visible to every context.
+ */
+void publish(Context& context, std::uintptr_t address, std::uint64_t value,
+             std::size_t size) {
+  auto& history = history_of(address, size);
+  history.push_back(value);
+  write_memory(address, value, size);
+  // The context cannot load an older value after its own store
+  context.view[address] = history.size() - 1;
+}
+
+void commit(Context& context, std::size_t index) {
+  const auto store = context.buffer[index];
+  context.buffer.erase(context.buffer.begin() + index);
+  publish(context, store.address, store.value, store.size);
+}
+
+void drain(Context& context) {
+  while (!context.buffer.empty()) {
+    commit(context, 0);
+  }
+}
+
+/**
+ * @brief Lets buffered stores become visible, in any order but the program
+ * order of the stores to the same location.
+ */
+void commit_stores() {
+  for (;;) {
+    std::vector<std::pair<std::size_t, std::size_t>> eligible;
+    for (std::size_t context = 0; context < g_state.contexts.size();
+         context++) {
+      const auto& buffer = g_state.contexts[context].buffer;
+      for (std::size_t index = 0; index < buffer.size(); index++) {
+        bool first = true;
+        for (std::size_t earlier = 0; earlier < index; earlier++) {
+          first = first && buffer[earlier].address != buffer[index].address;
+        }
+        if (first) {
+          eligible.emplace_back(context, index);
+        }
+      }
+    }
+    if (eligible.empty()) {
+      return;
+    }
+
+    const auto choice = choose(eligible.size() + 1);
+    if (choice == 0) {
+      return;
+    }
+    const auto [context, index] = eligible[choice - 1];
+    g_state.schedule +=
+        "  store of the " + context_name(static_cast<int>(context) - 1) +
+        " to " +
+        std::to_string(g_state.contexts[context].buffer[index].address) +
+        " becomes visible\n";
+    commit(g_state.contexts[context], index);
+  }
+}
+
+/**
+ * @brief Moves to the next schedule in depth-first order. Returns false once
+ * every schedule has been explored.
+ */
+auto next_schedule() -> bool {
+  g_state.decisions.resize(g_state.depth);
+  while (!g_state.decisions.empty() &&
+         g_state.decisions.back().choice + 1 ==
+             g_state.decisions.back().num_choices) {
+    g_state.decisions.pop_back();
+  }
+  if (g_state.decisions.empty()) {
+    return false;
+  }
+  g_state.decisions.back().choice++;
+  return true;
+}
+
+}  // namespace
+
+auto interrupts_masked() -> bool { return g_state.primask; }
+
+void mask_interrupts(bool masked) {
+  g_state.primask = masked;
+  if (!masked) {
+    preemption_point();
+  }
+}
+
+void preemption_point() {
+  if (!g_state.active || g_state.primask) {
+    return;
+  }
+  g_state.points++;
+  if (g_state.weak) {
+    commit_stores();
+  }
+  schedule(g_state.interrupt_pending);
+}
+
+auto load(const volatile void* ptr, std::size_t size) -> std::uint64_t {
+  const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+  if (!is_weak()) {
+    return read_memory(address, size);
+  }
+
+  auto& context = current_context();
+  // The context sees its own buffered stores
+  for (auto it = context.buffer.rbegin(); it != context.buffer.rend(); ++it) {
+    if (it->address == address) {
+      return it->value;
+    }
+  }
+
+  const auto& history = history_of(address, size);
+  auto& view = context.view[address];
+  const auto num_values = history.size() - view;
+  // The latest value comes first, so the first schedule is sequential
+  const auto choice = num_values == 1 ? 0 : choose(num_values);
+  view = history.size() - 1 - choice;
+  if (choice != 0) {
+    g_state.schedule += "  " + context_name(g_state.priority) +
+                        " loads a stale value of " + std::to_string(address) +
+                        "\n";
+  }
+  return history[view];
+}
+
+void store(volatile void* ptr, std::uint64_t value, std::size_t size) {
+  const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+  if (!is_weak()) {
+    write_memory(address, value, size);
+    return;
+  }
+  current_context().buffer.push_back({address, size, value});
+}
+
+auto locked_load(const volatile void* ptr, std::size_t size)
+    -> std::uint64_t {
+  const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+  if (!is_weak()) {
+    return read_memory(address, size);
+  }
+
+  // Earlier stores of the context to the location come first
+  auto& context = current_context();
+  for (std::size_t index = 0; index < context.buffer.size();) {
+    if (context.buffer[index].address == address) {
+      commit(context, index);
+    } else {
+      index++;
+    }
+  }
+  const auto& history = history_of(address, size);
+  context.view[address] = history.size() - 1;
+  return history.back();
+}
+
+void locked_store(volatile void* ptr, std::uint64_t value, std::size_t size) {
+  const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+  if (!is_weak()) {
+    write_memory(address, value, size);
+    return;
+  }
+  publish(current_context(), address, value, size);
+}
+
+void memory_barrier() {
+  if (is_weak()) {
+    auto& context = current_context();
+    drain(context);
+    for (const auto& [address, history] : g_state.history) {
+      context.view[address] = history.size() - 1;
+    }
+  }
+  preemption_point();
+}
+
+void wait_for_interrupt() {
+  if (!g_state.active) {
+    return;
+  }
+  if (eligible_isrs().empty()) {
+    throw ExecutionFailed{"deadlock: wfi with no ISR left to run"};
+  }
+  g_state.interrupt_pending = true;
+  preemption_point();
+}
+
+void fail(const std::string& message) { throw ExecutionFailed{message}; }
+
+ModelChecker::ModelChecker(Function setup, Function thread,
+                           std::vector<Function> isrs,
+                           std::function<bool()> check,
+                           MemoryModel memory_model)
+    : setup_(std::move(setup)),
+      thread_(std::move(thread)),
+      isrs_(std::move(isrs)),
+      check_(std::move(check)),
+      memory_model_(memory_model) {}
+
+auto ModelChecker::run(std::size_t max_executions) -> Result {
+  Result result;
+  g_state = State{};
+  g_state.isrs = &isrs_;
+  g_state.weak = memory_model_ == MemoryModel::kWeak;
+
+  do {
+    g_state.primask = false;
+    g_state.interrupt_pending = false;
+    g_state.priority = -1;
+    g_state.fired.assign(isrs_.size(), false);
+    g_state.depth = 0;
+    g_state.points = 0;
+    g_state.schedule.clear();
+    g_state.contexts.assign(isrs_.size() + 1, Context{});
+    g_state.history.clear();
+
+    setup_();
+    g_state.active = true;
+    std::string failure;
+    try {
+      // ISRs may also run before the thread starts
+      preemption_point();
+      thread_();
+      if (g_state.primask) {
+        throw ExecutionFailed{"the thread returned with interrupts masked"};
+      }
+      while (!eligible_isrs().empty()) {
+        schedule(true);
+      }
+      // Stores that are still buffered become visible eventually
+      for (auto& context : g_state.contexts) {
+        drain(context);
+      }
+      g_state.active = false;
+      if (!check_()) {
+        failure = "check failed";
+      }
+    } catch (const ExecutionFailed& error) {
+      failure = error.message;
+    }
+    g_state.active = false;
+    result.executions++;
+
+    if (!failure.empty()) {
+      result.passed = false;
+      result.failure = failure + "\nSchedule:\n" + g_state.schedule;
+      break;
+    }
+  } while ((max_executions == 0 || result.executions < max_executions) &&
+           next_schedule());
+  return result;
+}
+
+}  // namespace cortex_m_atomics::host
@@ -0,0 +1,53 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cortex_m_atomics/multicore.h"
+
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+
+#include <cstdint>
+
+namespace {
+
+// Critical sections each core is in. A core only accesses its own entry, with
+// interrupts masked
+std::uint32_t g_depth[CORTEX_M_ATOMICS_MAX_CORES];
+
+}  // namespace
+
+extern "C" void cortex_m_atomics_multicore_lock() {
+  // Counted per core instead of relying on PRIMASK, which code outside of the
+  // library may have set without taking the spinlock
+  if (g_depth[cortex_m_atomics_core_id()]++ == 0) {
+    cortex_m_atomics_spinlock_acquire();
+  }
+}
+
+extern "C" void cortex_m_atomics_multicore_unlock() {
+  if (--g_depth[cortex_m_atomics_core_id()] == 0) {
+    cortex_m_atomics_spinlock_release();
+  }
+}
+
+#endif
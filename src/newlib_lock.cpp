@@ -0,0 +1,270 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Locks for newlib, so that malloc can be used from ISRs and threads alike.
+ *
+ * On a single core, holding any of the static locks means that interrupts are
+ * masked, so nothing can contend for it. Acquiring a lock masks interrupts and
+ * releasing the last lock held restores them, which is the cheapest correct
+ * lock.
+ *
+ * The locks created at runtime protect FILE streams, and are held across the
+ * _read and _write syscalls. These may wait for an interrupt, e.g. from a
+ * UART or a timeout timer, so stream locks do not mask interrupts. They are
+ * recursion counters instead, and streams may only be used from thread mode.
+ *
+ * On multi-core parts, the static locks also take the spinlock shared by the
+ * cores, which is held until the last one is released. Stream locks are owned
+ * by the thread of one core at a time, and the other cores spin until it
+ * releases them.
+ */
+
+#if __has_include(<sys/lock.h>)
+#include <sys/lock.h>
+#endif
+
+#if defined(_RETARGETABLE_LOCKING) || defined(_NEWLIB_VERSION)
+
+#include <cassert>
+#include <cstdint>
+
+#include "cortex_m_atomics/critical_section.h"
+
+namespace {
+
+/**
+ * @brief Returns the number of the exception being handled, or 0 in thread
+ * mode. Identifies the context that owns a lock.
+ */
+inline auto current_context() -> std::uint32_t {
+  std::uint32_t ipsr;
+  asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+  return ipsr;
+}
+
+// Number of locks held. Interrupts are masked while it is not 0. On
+// multi-core parts, the spinlock is held too, which protects both variables
+std::uint32_t g_depth = 0;
+// Whether interrupts were enabled before taking the first lock
+bool g_interrupts_were_enabled = false;
+
+}  // namespace
+
+struct __lock {
+  // Context holding the lock, only meaningful while count is not 0. For stream
+  // locks on multi-core parts, the core holding it plus one, or 0
+  std::uint32_t owner;
+  std::uint32_t count;
+};
+
+namespace {
+
+/**
+ * @brief Masks interrupts, and takes the spinlock on multi-core parts, for as
+ * long as any static lock is held.
+ */
+void enter() {
+  const bool enabled = !cortex_m_atomics::get_interrupt_mask();
+  cortex_m_atomics::disable_interrupts();
+  cortex_m_atomics::multicore_lock();
+  if (g_depth++ == 0) {
+    g_interrupts_were_enabled = enabled;
+  }
+}
+
+void leave() {
+  // Locks are not always released in the reverse order they were taken, so
+  // interrupts are restored when the last one is released
+  const bool enable = --g_depth == 0 && g_interrupts_were_enabled;
+  cortex_m_atomics::multicore_unlock();
+  if (enable) {
+    cortex_m_atomics::enable_interrupts();
+  }
+}
+
+void acquire(__lock* lock, bool recursive) {
+  enter();
+  // With interrupts masked, a lock that is held can only be taken again by
+  // its owner, and only if it is recursive. Anything else is a fault handler
+  // or NMI using newlib, or a bug in newlib
+  assert(lock->count == 0 || (recursive && lock->owner == current_context()));
+  if (lock->count++ == 0) {
+    lock->owner = current_context();
+  }
+}
+
+void release(__lock* lock) {
+  lock->count--;
+  leave();
+}
+
+}  // namespace
+
+#if defined(_RETARGETABLE_LOCKING)
+
+struct __lock __lock___sinit_recursive_mutex;
+struct __lock __lock___sfp_recursive_mutex;
+struct __lock __lock___atexit_recursive_mutex;
+struct __lock __lock___at_quick_exit_mutex;
+struct __lock __lock___malloc_recursive_mutex;
+struct __lock __lock___env_recursive_mutex;
+struct __lock __lock___tz_mutex;
+struct __lock __lock___dd_hash_mutex;
+struct __lock __lock___arc4random_mutex;
+
+namespace {
+
+// Locks created at runtime, i.e. for each FILE. They only need a recursion
+// counter, so they all share the same one.
+struct __lock g_stream_lock;
+
+/**
+ * @brief Checks if a lock is only used by stdio, which may block on
+ * interrupts while holding it.
+ */
+auto is_stream_lock(_LOCK_T lock) -> bool {
+  return lock == &g_stream_lock || lock == &__lock___sfp_recursive_mutex ||
+         lock == &__lock___sinit_recursive_mutex;
+}
+
+/**
+ * @brief Takes a stream lock. Interrupts stay enabled, so the lock would not
+ * protect the stream from an ISR, which is why it is only taken from thread
+ * mode. On a single core there is a single thread, so nothing else can contend
+ * for it.
+ */
+void acquire_stream(__lock* lock) {
+  // stdio used from an ISR. Not an assert, since __assert_func prints to
+  // stderr, which would take this lock again and recurse
+  if (current_context() != 0) {
+    __builtin_trap();
+  }
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  // Only this core stores its own number, so it holds the lock if it reads it
+  const auto core = cortex_m_atomics_core_id() + 1;
+  while (!cortex_m_atomics::critical_section([&]() {
+    if (lock->owner == 0) {
+      lock->owner = core;
+    }
+    return lock->owner == core;
+  })) {
+  }
+#endif
+  lock->count++;
+}
+
+void release_stream(__lock* lock) {
+#if defined(CORTEX_M_ATOMICS_MULTICORE)
+  if (--lock->count == 0) {
+    cortex_m_atomics::critical_section([&]() { lock->owner = 0; });
+  }
+#else
+  lock->count--;
+#endif
+}
+
+}  // namespace
+
+extern "C" void __retarget_lock_init(_LOCK_T* lock) { *lock = &g_stream_lock; }
+
+extern "C" void __retarget_lock_init_recursive(_LOCK_T* lock) {
+  *lock = &g_stream_lock;
+}
+
+extern "C" void __retarget_lock_close(_LOCK_T) {}
+
+extern "C" void __retarget_lock_close_recursive(_LOCK_T) {}
+
+extern "C" void __retarget_lock_acquire(_LOCK_T lock) {
+  if (is_stream_lock(lock)) {
+    acquire_stream(lock);
+  } else {
+    acquire(lock, false);
+  }
+}
+
+extern "C" void __retarget_lock_acquire_recursive(_LOCK_T lock) {
+  if (is_stream_lock(lock)) {
+    acquire_stream(lock);
+  } else {
+    acquire(lock, true);
+  }
+}
+
+extern "C" int __retarget_lock_try_acquire(_LOCK_T lock) {
+  if (is_stream_lock(lock)) {
+    acquire_stream(lock);
+    return 1;
+  }
+  // Checked with interrupts masked and the spinlock held, like acquire().
+  // Only the owner can hold the lock then, so a non-recursive lock that is
+  // already held is a recursive use of it
+  enter();
+  if (lock->count != 0) {
+    leave();
+    return 0;
+  }
+  lock->count = 1;
+  lock->owner = current_context();
+  return 1;
+}
+
+extern "C" int __retarget_lock_try_acquire_recursive(_LOCK_T lock) {
+  __retarget_lock_acquire_recursive(lock);
+  return 1;
+}
+
+extern "C" void __retarget_lock_release(_LOCK_T lock) {
+  if (is_stream_lock(lock)) {
+    release_stream(lock);
+  } else {
+    release(lock);
+  }
+}
+
+extern "C" void __retarget_lock_release_recursive(_LOCK_T lock) {
+  __retarget_lock_release(lock);
+}
+
+#else
+
+// Without retargetable locking, newlib only provides the malloc hooks
+struct _reent;
+
+namespace {
+
+struct __lock g_malloc_lock;
+
+}  // namespace
+
+extern "C" void __malloc_lock(struct _reent*) {
+  acquire(&g_malloc_lock, true);
+}
+
+extern "C" void __malloc_unlock(struct _reent*) { release(&g_malloc_lock); }
+
+#endif  // _RETARGETABLE_LOCKING
+
+#endif  // _RETARGETABLE_LOCKING || _NEWLIB_VERSION
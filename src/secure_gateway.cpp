@@ -0,0 +1,156 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Non-secure callable veneers for atomics on a secure-shared region. Only
+ * built into secure images, i.e. when compiling with -mcmse.
+ */
+
+#if defined(__ARM_FEATURE_CMSE) && (__ARM_FEATURE_CMSE == 3)
+
+#include "cortex_m_atomics/secure_gateway.h"
+
+#include <arm_cmse.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+// Only written by the secure image before the non-secure image starts
+std::uintptr_t g_region_base = 0;
+std::size_t g_region_size = 0;
+
+/**
+ * @brief Checks that a word at ptr lies within the registered region, and
+ * that the non-secure caller could access it itself. The pointer comes from
+ * non-secure code and must not be trusted to point anywhere else,
+ * particularly into secure memory. The bounds alone would trust the region to
+ * be non-secure, so the test target instruction also checks the SAU and IDAU
+ * attribution and the non-secure MPU, with the privilege of the caller.
+ */
+inline auto is_shared_word(const volatile void* ptr, int access) -> bool {
+  const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+  const auto offset = address - g_region_base;
+  if ((address & (sizeof(std::uint32_t) - 1)) != 0 ||
+      g_region_size < sizeof(std::uint32_t) ||
+      offset > g_region_size - sizeof(std::uint32_t)) {
+    return false;
+  }
+  std::uint32_t control_ns;
+  std::uint32_t ipsr;
+  asm volatile("mrs %0, control_ns" : "=r"(control_ns));
+  asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+  // CONTROL_NS.nPRIV only applies to non-secure thread mode. Handlers are
+  // always privileged
+  if ((control_ns & 1) != 0 && ipsr == 0) {
+    access |= CMSE_MPU_UNPRIV;
+  }
+  return cmse_check_address_range(const_cast<void*>(ptr),
+                                  sizeof(std::uint32_t),
+                                  access | CMSE_NONSECURE) != nullptr;
+}
+
+}  // namespace
+
+namespace cortex_m_atomics {
+
+void register_secure_shared_region(void* base, std::size_t size) {
+  g_region_base = reinterpret_cast<std::uintptr_t>(base);
+  g_region_size = size;
+}
+
+}  // namespace cortex_m_atomics
+
+extern "C" {
+
+auto cma_secure_atomic_load_4(const std::uint32_t* ptr) -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READ)) {
+    return 0;
+  }
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+void cma_secure_atomic_store_4(std::uint32_t* ptr, std::uint32_t value) {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return;
+  }
+  __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+auto cma_secure_atomic_exchange_4(std::uint32_t* ptr, std::uint32_t value)
+    -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return 0;
+  }
+  return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+auto cma_secure_atomic_compare_exchange_4(std::uint32_t* ptr,
+                                          std::uint32_t expected,
+                                          std::uint32_t desired)
+    -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return ~expected;
+  }
+  __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST,
+                              __ATOMIC_SEQ_CST);
+  return expected;
+}
+
+auto cma_secure_atomic_fetch_add_4(std::uint32_t* ptr, std::uint32_t value)
+    -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return 0;
+  }
+  return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+auto cma_secure_atomic_fetch_sub_4(std::uint32_t* ptr, std::uint32_t value)
+    -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return 0;
+  }
+  return __atomic_fetch_sub(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+auto cma_secure_atomic_fetch_or_4(std::uint32_t* ptr, std::uint32_t value)
+    -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return 0;
+  }
+  return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+auto cma_secure_atomic_fetch_and_4(std::uint32_t* ptr, std::uint32_t value)
+    -> std::uint32_t {
+  if (!is_shared_word(ptr, CMSE_MPU_READWRITE)) {
+    return 0;
+  }
+  return __atomic_fetch_and(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+}  // extern "C"
+
+#endif
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2023 Francisco Javier Alvarez Garcia
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+"""Tests for tools/atomic_callsites.py, run on synthetic disassembly."""
+
+import os
+import sys
+import unittest
+
+sys.path.insert(
+    0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+
+import atomic_callsites  # pylint: disable=wrong-import-position
+
+DISASSEMBLY = """
+00000100 <producer>:
+     100:\tmovs\tr2, #5
+     102:\tbl\t400 <__atomic_fetch_add_4>
+     106:\tmovs\tr2, #0
+     108:\tbl\t420 <__atomic_store_4>
+     10c:\tbl\t440 <__atomic_is_lock_free>
+     110:\tbl\t460 <__sync_synchronize>
+     114:\tbx\tlr
+
+00000200 <consumer>:
+     200:\tmovs\tr1, #2
+     202:\tbl\t480 <__atomic_load_4>
+     206:\tmovs\tr2, #5
+     208:\tbl\t420 <__atomic_store_4>
+     20c:\tbx\tlr
+
+00000400 <__atomic_add_fetch_4>:
+     400:\tbl\t400 <__atomic_fetch_add_4>
+     404:\tbx\tlr
+"""
+
+
+def call_sites(config=atomic_callsites.DEFAULT_CONFIG):
+    sites = atomic_callsites.find_call_sites(DISASSEMBLY, config)
+    return {(site.caller, site.symbol, site.order): site for site in sites}
+
+
+class FindCallSitesTest(unittest.TestCase):
+
+    def test_finds_every_call_outside_of_the_intrinsics(self):
+        self.assertEqual(len(call_sites()), 6)
+
+    def test_traces_the_order_argument(self):
+        sites = call_sites()
+        self.assertIn(("producer", "__atomic_fetch_add_4", 5), sites)
+        self.assertIn(("producer", "__atomic_store_4", 0), sites)
+        self.assertIn(("consumer", "__atomic_load_4", 2), sites)
+
+    def test_order_is_not_traced_across_calls(self):
+        self.assertIn(("producer", "__atomic_is_lock_free", None),
+                      call_sites())
+
+
+class CostTest(unittest.TestCase):
+
+    def test_read_modify_write_masks_interrupts(self):
+        site = call_sites()[("producer", "__atomic_fetch_add_4", 5)]
+        self.assertTrue(site.critical_section)
+        self.assertEqual(site.reasons, ["rmw", "order:seq_cst"])
+        self.assertEqual(site.masked_cycles, 2 + 1 + 2 + 2 * 4)
+
+    def test_aligned_store_does_not_mask_interrupts(self):
+        site = call_sites()[("consumer", "__atomic_store_4", 5)]
+        self.assertFalse(site.critical_section)
+        self.assertEqual(site.masked_cycles, 0)
+        self.assertEqual(site.flags(), "")
+
+    def test_symbols_without_cost_are_unknown(self):
+        sites = call_sites()
+        for symbol in ("__atomic_is_lock_free", "__sync_synchronize"):
+            site = sites[("producer", symbol, None)]
+            self.assertIsNone(site.critical_section)
+            self.assertEqual(site.masked_cycles, 0)
+            self.assertEqual(site.flags(), "[unknown]")
+            self.assertIsNone(site.to_dict()["critical_section"])
+
+    def test_unaligned_accesses_are_masked_without_fences(self):
+        config = atomic_callsites.Config("primask", False, True)
+        site = call_sites(config)[("consumer", "__atomic_load_4", 2)]
+        self.assertEqual(site.reasons, ["unaligned"])
+        self.assertEqual(site.masked_cycles, 4 * 2)
+
+    def test_multicore_stores_take_the_spinlock(self):
+        config = atomic_callsites.Config("primask", True, False)
+        site = call_sites(config)[("consumer", "__atomic_store_4", 5)]
+        self.assertEqual(site.reasons, ["multicore"])
+        self.assertEqual(site.masked_cycles,
+                         atomic_callsites.CYCLES_SPINLOCK + 2)
+
+    def test_acquire_release_stores_skip_the_spinlock(self):
+        config = atomic_callsites.Config("acquire-release", True, False)
+        sites = call_sites(config)
+        self.assertFalse(sites[("consumer", "__atomic_store_4",
+                                5)].critical_section)
+        self.assertTrue(sites[("producer", "__atomic_store_4",
+                               0)].critical_section)
+
+    def test_exclusive_backend_only_masks_in_the_fallback(self):
+        config = atomic_callsites.Config("exclusive", False, False)
+        site = call_sites(config)[("producer", "__atomic_fetch_add_4", 5)]
+        self.assertEqual(site.reasons, ["exclusive fallback"])
+        self.assertEqual(site.masked_cycles, 2 + 1 + 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
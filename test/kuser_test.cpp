@@ -0,0 +1,96 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Runs the intrinsics of the kuser helpers backend from several threads, for
+// each size. Built for ARM Linux, and run with qemu-arm when cross compiling.
+// The test is compiled with -fno-inline-atomics, so that std::atomic calls the
+// library even where the compiler could use ldrex/strex itself.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t kNumThreads = 4;
+constexpr std::uint32_t kIterations = 20000;
+
+/**
+ * @brief Two neighbours share the word that holds a 1 or 2 byte atomic, so
+ * that swapping the whole word must leave them untouched.
+ */
+template <class T>
+struct Padded {
+  std::atomic<T> before{0};
+  std::atomic<T> value{0};
+  std::atomic<T> after{0};
+};
+
+template <class T>
+auto check(const char* name) -> bool {
+  Padded<T> counter;
+  Padded<T> cas_counter;
+  counter.before.store(static_cast<T>(0x5a));
+  counter.after.store(static_cast<T>(0xa5));
+
+  std::vector<std::thread> threads;
+  for (std::uint32_t thread = 0; thread < kNumThreads; thread++) {
+    threads.emplace_back([&]() {
+      for (std::uint32_t i = 0; i < kIterations; i++) {
+        counter.value.fetch_add(1);
+        auto expected = cas_counter.value.load();
+        while (!cas_counter.value.compare_exchange_weak(
+            expected, static_cast<T>(expected + 1))) {
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // The counters wrap at the width of T
+  const auto expected = static_cast<T>(kNumThreads * kIterations);
+  const bool ok = counter.value.load() == expected &&
+                  cas_counter.value.load() == expected &&
+                  counter.before.load() == static_cast<T>(0x5a) &&
+                  counter.after.load() == static_cast<T>(0xa5) &&
+                  counter.value.exchange(0) == expected &&
+                  counter.value.load() == 0;
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+  return ok;
+}
+
+}  // namespace
+
+auto main() -> int {
+  bool passed = true;
+  passed = check<std::uint8_t>("1 byte") && passed;
+  passed = check<std::uint16_t>("2 bytes") && passed;
+  passed = check<std::uint32_t>("4 bytes") && passed;
+  passed = check<std::uint64_t>("8 bytes") && passed;
+  return passed ? 0 : 1;
+}
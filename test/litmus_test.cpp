@@ -0,0 +1,191 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Litmus tests for the barriers of the intrinsics, run by the model checker
+// under its weak memory model. Each test is a small program and an outcome
+// that the memory orders used either forbid, which no schedule may produce,
+// or allow, which some schedule must produce so that the test shows the
+// barriers are needed.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "cortex_m_atomics/model_checker.h"
+
+namespace {
+
+using cortex_m_atomics::host::ModelChecker;
+
+constexpr auto relaxed = std::memory_order_relaxed;
+constexpr auto acquire = std::memory_order_acquire;
+constexpr auto release = std::memory_order_release;
+constexpr auto seq_cst = std::memory_order_seq_cst;
+
+std::atomic<std::uint32_t> x;
+std::atomic<std::uint32_t> y;
+std::uint32_t r1;
+std::uint32_t r2;
+std::uint32_t r3;
+std::uint32_t r4;
+
+struct Litmus {
+  const char* name;
+  ModelChecker::Function thread;
+  std::vector<ModelChecker::Function> isrs;
+  std::function<bool()> outcome;
+  bool allowed;
+};
+
+/**
+ * @brief Message passing: the reader must not see the flag without the data.
+ */
+auto message_passing(const char* name, std::memory_order store_order,
+                     std::memory_order load_order, bool allowed) -> Litmus {
+  return {name,
+          [=]() {
+            x.store(1, relaxed);
+            y.store(1, store_order);
+          },
+          {[=]() {
+            r1 = y.load(load_order);
+            r2 = x.load(relaxed);
+          }},
+          []() { return r1 == 1 && r2 == 0; },
+          allowed};
+}
+
+/**
+ * @brief Store buffering: one of the contexts must see the store of the
+ * other one.
+ */
+auto store_buffering(const char* name, std::memory_order store_order,
+                     std::memory_order load_order, bool allowed) -> Litmus {
+  return {name,
+          [=]() {
+            x.store(1, store_order);
+            r1 = y.load(load_order);
+          },
+          {[=]() {
+            y.store(1, store_order);
+            r2 = x.load(load_order);
+          }},
+          []() { return r1 == 0 && r2 == 0; },
+          allowed};
+}
+
+/**
+ * @brief Load buffering: each context must not read the value that the other
+ * one stores after its load.
+ */
+auto iriw(const char* name, std::memory_order order, bool allowed) -> Litmus {
+  return {name,
+          [=]() { x.store(1, order); },
+          {[=]() { y.store(1, order); },
+           [=]() {
+             r1 = x.load(order);
+             r2 = y.load(order);
+           },
+           [=]() {
+             r3 = y.load(order);
+             r4 = x.load(order);
+           }},
+          []() { return r1 == 1 && r2 == 0 && r3 == 1 && r4 == 0; },
+          allowed};
+}
+
+/**
+ * @brief Runs the test, returning whether the outcome was found as expected.
+ */
+auto run(const Litmus& litmus) -> bool {
+  ModelChecker checker(
+      []() {
+        x.store(0, relaxed);
+        y.store(0, relaxed);
+        r1 = r2 = r3 = r4 = 0;
+      },
+      litmus.thread, litmus.isrs, [&]() { return !litmus.outcome(); },
+      ModelChecker::MemoryModel::kWeak);
+  const auto result = checker.run();
+  const bool observed = !result.passed;
+  const bool ok = observed == litmus.allowed;
+  std::printf("%s %s: outcome %s after %zu executions\n", ok ? "ok  " : "FAIL",
+              litmus.name, observed ? "observed" : "not observed",
+              result.executions);
+  if (!ok && observed) {
+    std::printf("%s", result.failure.c_str());
+  }
+  return ok;
+}
+
+}  // namespace
+
+auto main() -> int {
+  const Litmus tests[] = {
+      message_passing("MP release/acquire", release, acquire, false),
+      message_passing("MP relaxed/acquire", relaxed, acquire, true),
+      message_passing("MP release/relaxed", release, relaxed, true),
+      {"MP exchange/fetch_add",
+       []() {
+         x.store(1, relaxed);
+         y.exchange(1, release);
+       },
+       {[]() {
+         r1 = y.fetch_add(0, acquire);
+         r2 = x.load(relaxed);
+       }},
+       []() { return r1 == 1 && r2 == 0; },
+       false},
+      {"MP relaxed exchange/fetch_add",
+       []() {
+         x.store(1, relaxed);
+         y.exchange(1, relaxed);
+       },
+       {[]() {
+         r1 = y.fetch_add(0, relaxed);
+         r2 = x.load(relaxed);
+       }},
+       []() { return r1 == 1 && r2 == 0; },
+       true},
+      store_buffering("SB seq_cst/seq_cst", seq_cst, seq_cst, false),
+      store_buffering("SB release/acquire", release, acquire, true),
+      // C++ allows SB as soon as one of the accesses is not seq_cst. These
+      // two check that this implementation is stronger than that, so a
+      // change to the barriers that weakens it is noticed
+      store_buffering("SB seq_cst store/acquire load (implementation)",
+                      seq_cst, acquire, false),
+      store_buffering("SB release store/seq_cst load (implementation)",
+                      release, seq_cst, false),
+      iriw("IRIW seq_cst", seq_cst, false),
+      iriw("IRIW relaxed", relaxed, true),
+  };
+
+  bool passed = true;
+  for (const auto& test : tests) {
+    passed = run(test) && passed;
+  }
+  return passed ? 0 : 1;
+}
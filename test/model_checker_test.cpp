@@ -0,0 +1,325 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Model checks the lock-free structures of the library on a single core: each
+// program runs once per schedule of its ISRs, and its check must hold in all
+// of them. The last test seeds a race and expects the checker to find it.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "cortex_m_atomics/broadcast_ring.h"
+#include "cortex_m_atomics/executor.h"
+#include "cortex_m_atomics/hash_map.h"
+#include "cortex_m_atomics/intrusive_lifo.h"
+#include "cortex_m_atomics/model_checker.h"
+#include "cortex_m_atomics/mpmc_queue.h"
+#include "cortex_m_atomics/sleep.h"
+
+namespace {
+
+using cortex_m_atomics::AtomicHashMap;
+using cortex_m_atomics::BroadcastRing;
+using cortex_m_atomics::Executor;
+using cortex_m_atomics::IntrusiveLifo;
+using cortex_m_atomics::MpmcQueue;
+using cortex_m_atomics::Task;
+using cortex_m_atomics::host::ModelChecker;
+
+/**
+ * @brief Runs the checker, returning whether it found a failing schedule as
+ * expected.
+ */
+auto expect(const char* name, ModelChecker checker, bool should_pass) -> bool {
+  const auto result = checker.run();
+  const bool ok = result.passed == should_pass;
+  std::printf("%s %s: %s after %zu executions\n", ok ? "ok  " : "FAIL", name,
+              result.passed ? "passed" : "failed", result.executions);
+  if (!result.passed) {
+    std::printf("%s", result.failure.c_str());
+  }
+  return ok;
+}
+
+struct Node {
+  std::uint32_t id;
+  Node* next = nullptr;
+};
+
+Node nodes[3] = {{0}, {1}, {2}};
+std::vector<std::uint32_t> taken;
+
+void take_all(IntrusiveLifo<Node>& lifo) {
+  for (Node* node = lifo.take_all(); node != nullptr; node = node->next) {
+    taken.push_back(node->id);
+  }
+}
+
+/**
+ * @brief The thread and two ISRs push nodes while the thread takes them. Every
+ * node must be taken exactly once.
+ */
+auto intrusive_lifo() -> bool {
+  static std::optional<IntrusiveLifo<Node>> lifo;
+  return expect(
+      "IntrusiveLifo",
+      ModelChecker(
+          []() {
+            lifo.emplace();
+            taken.clear();
+          },
+          []() {
+            lifo->push(nodes[0]);
+            take_all(*lifo);
+          },
+          {[]() { lifo->push(nodes[1]); }, []() { lifo->push(nodes[2]); }},
+          []() {
+            take_all(*lifo);
+            std::sort(taken.begin(), taken.end());
+            return taken == std::vector<std::uint32_t>{0, 1, 2};
+          }),
+      true);
+}
+
+std::uint32_t runs[3];
+std::uint32_t isr_posts;
+
+void count_run(void* context) { runs[*static_cast<std::uint32_t*>(context)]++; }
+
+std::uint32_t task_ids[3] = {0, 1, 2};
+std::optional<Task> tasks[3];
+
+/**
+ * @brief ISRs post tasks of both priorities while the thread runs the executor
+ * and sleeps until an ISR posts again. Every posted task must then be ready,
+ * and run exactly once.
+ */
+auto executor_ready_bitmap() -> bool {
+  static std::optional<Executor<2>> executor;
+  static const auto isr_post = [](std::size_t task) {
+    executor->post(*tasks[task]);
+    isr_posts++;
+  };
+  return expect(
+      "Executor ready bitmap",
+      ModelChecker(
+          []() {
+            executor.emplace();
+            for (std::uint32_t i = 0; i < 3; i++) {
+              tasks[i].emplace(count_run, &task_ids[i], i == 1 ? 1 : 0);
+              runs[i] = 0;
+            }
+            isr_posts = 0;
+          },
+          []() {
+            executor->post(*tasks[0]);
+            while (runs[0] + runs[1] + runs[2] < 3) {
+              if (executor->run_once()) {
+                continue;
+              }
+              cortex_m_atomics::sleep_until(
+                  []() { return isr_posts > runs[1] + runs[2]; });
+              if (!executor->run_once()) {
+                cortex_m_atomics::host::fail("a posted task is not ready");
+              }
+            }
+          },
+          {[]() { isr_post(1); }, []() { isr_post(2); }},
+          []() { return runs[0] == 1 && runs[1] == 1 && runs[2] == 1; }),
+      true);
+}
+
+constexpr std::size_t kNumConsumers = 2;
+std::vector<std::uint32_t> published;
+std::vector<std::uint32_t> consumed[kNumConsumers];
+
+/**
+ * @brief The thread publishes more entries than fit in the ring while two ISRs
+ * consume them. Each consumer must read every published entry once, in order.
+ */
+auto broadcast_ring() -> bool {
+  using Ring = BroadcastRing<std::uint32_t, 2, kNumConsumers>;
+  static std::optional<Ring> ring;
+  static const auto consume = [](std::size_t consumer) {
+    while (const auto* entry = ring->peek(consumer)) {
+      consumed[consumer].push_back(*entry);
+      ring->release(consumer);
+    }
+  };
+  return expect(
+      "BroadcastRing",
+      ModelChecker(
+          []() {
+            ring.emplace();
+            published.clear();
+            for (auto& values : consumed) {
+              values.clear();
+            }
+          },
+          []() {
+            for (std::uint32_t value = 1; value <= 4; value++) {
+              if (ring->try_publish(value)) {
+                published.push_back(value);
+              }
+            }
+          },
+          {[]() { consume(0); }, []() { consume(1); }},
+          []() {
+            for (std::size_t consumer = 0; consumer < kNumConsumers;
+                 consumer++) {
+              consume(consumer);
+              if (consumed[consumer] != published) {
+                return false;
+              }
+            }
+            return true;
+          }),
+      true);
+}
+
+std::vector<std::uint32_t> pushed;
+std::vector<std::uint32_t> popped;
+
+/**
+ * @brief The thread and an ISR push while the thread and another ISR pop.
+ * Every pushed value must be popped exactly once.
+ */
+auto mpmc_queue() -> bool {
+  static std::optional<MpmcQueue<std::uint32_t, 2>> queue;
+  static const auto push = [](std::uint32_t value) {
+    if (queue->try_push(value)) {
+      pushed.push_back(value);
+    }
+  };
+  static const auto pop = []() {
+    std::uint32_t value;
+    if (queue->try_pop(value)) {
+      popped.push_back(value);
+    }
+  };
+  return expect(
+      "MpmcQueue",
+      ModelChecker(
+          []() {
+            queue.emplace();
+            pushed.clear();
+            popped.clear();
+          },
+          []() {
+            push(1);
+            push(2);
+            pop();
+          },
+          {[]() { push(10); }, []() { pop(); }},
+          []() {
+            std::uint32_t value;
+            while (queue->try_pop(value)) {
+              popped.push_back(value);
+            }
+            std::sort(pushed.begin(), pushed.end());
+            std::sort(popped.begin(), popped.end());
+            return pushed == popped;
+          }),
+      true);
+}
+
+/**
+ * @brief The thread updates a key while an ISR erases it and inserts another
+ * key with the same home slot, which reuses the slot, and another ISR looks
+ * the other key up. The update must never change the value of that key.
+ */
+auto atomic_hash_map() -> bool {
+  // Both keys have home slot 1 in a map of capacity 2
+  static constexpr std::uint32_t kUpdated = 1;
+  static constexpr std::uint32_t kReused = 3;
+  static std::optional<AtomicHashMap<2>> map;
+  static const auto expect_value = [](std::uint32_t key,
+                                      std::uint32_t expected) {
+    std::uint32_t value;
+    if (map->find(key, value) && value != expected) {
+      cortex_m_atomics::host::fail("a key has the value of another key");
+    }
+  };
+  return expect(
+      "AtomicHashMap",
+      ModelChecker(
+          []() {
+            map.emplace();
+            map->insert(kUpdated, 10);
+          },
+          []() { map->insert(kUpdated, 11); },
+          {[]() {
+             map->erase(kUpdated);
+             map->insert(kReused, 30);
+           },
+           []() { expect_value(kReused, 30); }},
+          []() {
+            std::uint32_t value;
+            return map->find(kReused, value) && value == 30;
+          }),
+      true);
+}
+
+/**
+ * @brief A push made of a separate load and store of the head loses the node
+ * of an ISR that runs in between. The checker must find that schedule.
+ */
+auto seeded_race() -> bool {
+  static std::atomic<Node*> head;
+  static const auto push = [](Node& node) {
+    node.next = head.load(std::memory_order_relaxed);
+    head.store(&node, std::memory_order_release);
+  };
+  return expect(
+      "Seeded race in a LIFO push",
+      ModelChecker([]() { head.store(nullptr, std::memory_order_relaxed); },
+                   []() { push(nodes[0]); }, {[]() { push(nodes[1]); }},
+                   []() {
+                     std::size_t count = 0;
+                     for (Node* node = head.load(std::memory_order_relaxed);
+                          node != nullptr; node = node->next) {
+                       count++;
+                     }
+                     return count == 2;
+                   }),
+      false);
+}
+
+}  // namespace
+
+auto main() -> int {
+  bool passed = true;
+  passed = intrusive_lifo() && passed;
+  passed = executor_ready_bitmap() && passed;
+  passed = broadcast_ring() && passed;
+  passed = mpmc_queue() && passed;
+  passed = atomic_hash_map() && passed;
+  passed = seeded_race() && passed;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Stress test of MpmcQueue with 1 to 4 producer and consumer threads, running
+// on the cores of the development machine with its own atomics instead of the
+// intrinsics, which are single core. Every value must be popped exactly once,
+// and each consumer must see the values of each producer in the order they
+// were pushed. Each configuration also reports its throughput, next to that of
+// the same ring guarded by a mutex.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cortex_m_atomics/mpmc_queue.h"
+
+namespace {
+
+constexpr std::uint32_t kMaxThreads = 4;
+constexpr std::uint32_t kValuesPerProducer = 100000;
+constexpr std::uint32_t kProducerShift = 24;
+constexpr std::size_t kCapacity = 64;
+
+/**
+ * @brief The baseline: a ring with the same interface as MpmcQueue, which
+ * serialises every push and pop on one lock.
+ */
+class LockedQueue {
+ public:
+  auto try_push(std::uint32_t value) -> bool {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (tail_ - head_ == kCapacity) {
+      return false;
+    }
+    values_[tail_++ % kCapacity] = value;
+    return true;
+  }
+
+  auto try_pop(std::uint32_t& value) -> bool {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (tail_ == head_) {
+      return false;
+    }
+    value = values_[head_++ % kCapacity];
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::uint32_t values_[kCapacity];
+  std::size_t head_ = 0;
+  std::size_t tail_ = 0;
+};
+
+/**
+ * @brief Runs the producers and consumers through a queue, checks what the
+ * consumers popped and prints the throughput. Returns whether the check
+ * passed.
+ */
+template <class Queue>
+auto run(const char* name, std::uint32_t num_producers,
+         std::uint32_t num_consumers) -> bool {
+  Queue queue;
+  std::atomic<std::uint32_t> num_popped{0};
+  const auto total = num_producers * kValuesPerProducer;
+
+  const auto produce = [&](std::uint32_t producer) {
+    for (std::uint32_t i = 0; i < kValuesPerProducer; i++) {
+      while (!queue.try_push((producer << kProducerShift) | i)) {
+        std::this_thread::yield();
+      }
+    }
+  };
+  const auto consume = [&](std::vector<std::uint32_t>& values) {
+    while (num_popped.load(std::memory_order_relaxed) < total) {
+      std::uint32_t value;
+      if (queue.try_pop(value)) {
+        values.push_back(value);
+        num_popped.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  std::vector<std::vector<std::uint32_t>> consumed(num_consumers);
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t consumer = 0; consumer < num_consumers; consumer++) {
+    threads.emplace_back(consume, std::ref(consumed[consumer]));
+  }
+  for (std::uint32_t producer = 0; producer < num_producers; producer++) {
+    threads.emplace_back(produce, producer);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  constexpr std::uint32_t kIndexMask = (1u << kProducerShift) - 1;
+  std::vector<std::vector<bool>> seen(
+      num_producers, std::vector<bool>(kValuesPerProducer, false));
+  bool passed = true;
+  for (const auto& values : consumed) {
+    std::vector<std::int64_t> last(num_producers, -1);
+    for (const auto value : values) {
+      const auto producer = value >> kProducerShift;
+      const auto index = value & kIndexMask;
+      if (producer >= num_producers || index >= kValuesPerProducer ||
+          seen[producer][index] || index <= last[producer]) {
+        std::printf("Unexpected value %08x\n", value);
+        passed = false;
+        break;
+      }
+      seen[producer][index] = true;
+      last[producer] = index;
+    }
+  }
+  for (const auto& values : seen) {
+    for (const bool value_seen : values) {
+      passed = passed && value_seen;
+    }
+  }
+  std::printf("%s %s, %u producers, %u consumers: %.2f Mops/s\n",
+              passed ? "ok  " : "FAIL", name, num_producers, num_consumers,
+              total / elapsed.count() / 1e6);
+  return passed;
+}
+
+}  // namespace
+
+auto main() -> int {
+  using cortex_m_atomics::MpmcQueue;
+  bool passed = true;
+  for (std::uint32_t threads = 1; threads <= kMaxThreads; threads++) {
+    passed = run<MpmcQueue<std::uint32_t, kCapacity>>("MpmcQueue", threads,
+                                                      threads) &&
+             passed;
+    passed = run<LockedQueue>("Locked queue", threads, threads) && passed;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Checks that the lanes of PackedCounters wrap around or saturate as selected,
+// and that updates never disturb the other lanes of their word, including
+// when an ISR updates a neighbouring lane in the middle of an update.
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+
+#include "cortex_m_atomics/model_checker.h"
+#include "cortex_m_atomics/packed_counters.h"
+
+namespace {
+
+using cortex_m_atomics::Overflow;
+using cortex_m_atomics::PackedCounters;
+using cortex_m_atomics::host::ModelChecker;
+
+auto check(bool ok, const char* name) -> bool {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+  return ok;
+}
+
+template <class Lane>
+auto wrap(const char* name) -> bool {
+  constexpr Lane kMax = static_cast<Lane>(~Lane{0});
+  PackedCounters<Lane, 8> counters;
+  bool ok = counters.add(1, kMax) == 0 && counters.add(1, 2) == kMax &&
+            counters.load(1) == 1;
+  ok = ok && counters.sub(2, 1) == 0 && counters.load(2) == kMax;
+  return check(ok, name);
+}
+
+template <class Lane>
+auto saturate(const char* name) -> bool {
+  constexpr Lane kMax = static_cast<Lane>(~Lane{0});
+  PackedCounters<Lane, 8, Overflow::kSaturate> counters;
+  bool ok = counters.add(1, kMax - 1) == 0 && counters.add(1, 5) == kMax - 1 &&
+            counters.load(1) == kMax && counters.add(1, 1) == kMax &&
+            counters.load(1) == kMax;
+  ok = ok && counters.add(2, 3) == 0 && counters.sub(2, 5) == 3 &&
+       counters.load(2) == 0;
+  return check(ok, name);
+}
+
+/**
+ * @brief Overflows and underflows every lane of a word in turn, and checks
+ * that the other lanes keep their values.
+ */
+template <class Lane, Overflow kOverflow>
+auto isolation(const char* name) -> bool {
+  using Counters = PackedCounters<Lane, 8, kOverflow>;
+  constexpr Lane kMax = static_cast<Lane>(~Lane{0});
+  constexpr auto kLanes = Counters::kNumWords * Counters::kLanesPerWord;
+  bool ok = true;
+  for (std::size_t lane = 0; lane < Counters::kLanesPerWord; lane++) {
+    Counters counters;
+    for (std::size_t other = 0; other < kLanes; other++) {
+      counters.add(other, static_cast<Lane>(other + 1));
+    }
+    counters.add(lane, kMax);
+    counters.sub(lane, kMax);
+    counters.sub(lane, kMax);
+    counters.reset(lane);
+    for (std::size_t other = 0; other < kLanes; other++) {
+      const auto expected = other == lane ? 0 : other + 1;
+      ok = ok && counters.load(other) == expected &&
+           Counters::lane_value(
+               counters.load_word(other / Counters::kLanesPerWord),
+               other % Counters::kLanesPerWord) == expected;
+    }
+  }
+  return check(ok, name);
+}
+
+/**
+ * @brief The thread and two ISRs update the lanes of the same word. No update
+ * may be lost.
+ */
+auto preempted_updates() -> bool {
+  static std::optional<PackedCounters<std::uint8_t, 4>> counters;
+  const auto result =
+      ModelChecker([]() { counters.emplace(); },
+                   []() {
+                     counters->add(0, 1);
+                     counters->add(1, 1);
+                   },
+                   {[]() { counters->add(1, 2); },
+                    []() {
+                      counters->add(2, 3);
+                      counters->sub(0, 1);
+                    }},
+                   []() {
+                     return counters->load(0) == 0 && counters->load(1) == 3 &&
+                            counters->load(2) == 3 && counters->load(3) == 0;
+                   })
+          .run();
+  return check(result.passed, "Updates preempted by ISRs");
+}
+
+}  // namespace
+
+auto main() -> int {
+  bool passed = true;
+  passed = wrap<std::uint8_t>("8 bit lanes wrap") && passed;
+  passed = wrap<std::uint16_t>("16 bit lanes wrap") && passed;
+  passed = saturate<std::uint8_t>("8 bit lanes saturate") && passed;
+  passed = saturate<std::uint16_t>("16 bit lanes saturate") && passed;
+  passed = isolation<std::uint8_t, Overflow::kWrap>(
+               "8 bit wrapping lanes are isolated") &&
+           passed;
+  passed = isolation<std::uint8_t, Overflow::kSaturate>(
+               "8 bit saturating lanes are isolated") &&
+           passed;
+  passed = isolation<std::uint16_t, Overflow::kWrap>(
+               "16 bit wrapping lanes are isolated") &&
+           passed;
+  passed = isolation<std::uint16_t, Overflow::kSaturate>(
+               "16 bit saturating lanes are isolated") &&
+           passed;
+  passed = preempted_updates() && passed;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Checks that the tag of a TaggedPtr wraps around without touching the
+// pointer, and that a compare exchange from a value read before an ABA
+// sequence fails even though the pointer is the same again.
+
+#include <cstdint>
+#include <cstdio>
+
+#include "cortex_m_atomics/tagged_ptr.h"
+
+namespace {
+
+using cortex_m_atomics::AtomicTaggedPtr;
+using cortex_m_atomics::TaggedPtr;
+
+struct alignas(8) Node {
+  std::uint32_t id;
+};
+
+Node nodes[2] = {{0}, {1}};
+
+auto check(bool ok, const char* name) -> bool {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+  return ok;
+}
+
+/**
+ * @brief Steps the tag through a full cycle and one more step.
+ */
+auto tag_wraps() -> bool {
+  using Ptr = TaggedPtr<Node>;
+  static_assert(Ptr::kTagMask == 7);
+  Ptr value{&nodes[1], Ptr::kTagMask - 1};
+  bool ok = value.ptr() == &nodes[1] && value.tag() == Ptr::kTagMask - 1;
+  value = value.next(&nodes[1]);
+  ok = ok && value.ptr() == &nodes[1] && value.tag() == Ptr::kTagMask;
+  value = value.next(&nodes[1]);
+  ok = ok && value.ptr() == &nodes[1] && value.tag() == 0;
+  // Tags wider than the alignment bits are truncated instead of corrupting
+  // the pointer
+  const Ptr wide{&nodes[0], Ptr::kTagMask + 2};
+  ok = ok && wide.ptr() == &nodes[0] && wide.tag() == 1;
+  return check(ok, "tag wraps around");
+}
+
+/**
+ * @brief A stack head goes from node 0 to node 1 and back while a stale copy
+ * of it is held, as when a pop is preempted by a pop and a push. The stale
+ * compare exchange must fail and report the current value.
+ */
+auto aba_detected() -> bool {
+  AtomicTaggedPtr<Node> head{TaggedPtr<Node>{&nodes[0], 0}};
+  auto stale = head.load();
+
+  auto current = head.load();
+  bool ok = head.compare_exchange(current, &nodes[1]);
+  current = head.load();
+  ok = ok && head.compare_exchange(current, &nodes[0]);
+  ok = ok && head.load().ptr() == stale.ptr();
+
+  auto expected = stale;
+  ok = ok && !head.compare_exchange(expected, &nodes[1]);
+  ok = ok && expected == head.load() && expected.tag() == 2;
+  // Retrying from the reported value succeeds
+  ok = ok && head.compare_exchange(expected, &nodes[1]);
+  ok = ok && head.load().ptr() == &nodes[1] && head.load().tag() == 3;
+  return check(ok, "ABA detected");
+}
+
+}  // namespace
+
+auto main() -> int {
+  bool passed = true;
+  passed = tag_wraps() && passed;
+  passed = aba_detected() && passed;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Francisco Javier Alvarez Garcia
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Checks the timer wheel against the expected expiry tick of every timer, for
+// deadlines, cancellations and re-arms on both sides of the cascades between
+// levels. Built with AddressSanitizer where available, so that a wheel that
+// still references a destroyed timer fails the test.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#include "cortex_m_atomics/timer_wheel.h"
+
+namespace {
+
+using cortex_m_atomics::Timer;
+
+// Small levels, so that the sweeps cross many cascades: 4, 16 and 64 ticks
+using Wheel = cortex_m_atomics::TimerWheel<3, 2>;
+
+constexpr std::uint32_t kMaxDelay = 80;
+constexpr std::uint32_t kNever = ~std::uint32_t{0};
+
+struct Expiry {
+  Wheel* wheel;
+  std::uint32_t count = 0;
+  std::uint32_t at = kNever;
+};
+
+void record(void* context) {
+  auto& expiry = *static_cast<Expiry*>(context);
+  expiry.count++;
+  expiry.at = expiry.wheel->now();
+}
+
+void advance(Wheel& wheel, std::uint32_t ticks) {
+  for (std::uint32_t i = 0; i < ticks; i++) {
+    wheel.tick();
+  }
+}
+
+auto check(bool ok, const char* name, std::uint32_t start, std::uint32_t a,
+           std::uint32_t b) -> bool {
+  if (!ok) {
+    std::printf("FAIL %s: start %u, %u, %u\n", name, start, a, b);
+  }
+  return ok;
+}
+
+/**
+ * @brief Arms a timer and checks that it expires exactly once, at its
+ * deadline.
+ */
+auto arm_expires(std::uint32_t start, std::uint32_t delay) -> bool {
+  Wheel wheel;
+  advance(wheel, start);
+  Expiry expiry{&wheel};
+  Timer timer(record, &expiry);
+  wheel.arm_after(timer, delay);
+  advance(wheel, kMaxDelay * 2);
+  // A deadline that is not in the future expires on the next tick
+  const auto expected = start + (delay == 0 ? 1 : delay);
+  return check(expiry.count == 1 && expiry.at == expected &&
+                   Wheel::is_idle(timer),
+               "arm", start, delay, 0);
+}
+
+/**
+ * @brief Cancels a timer some ticks after arming it and destroys it as soon
+ * as the wheel reports it idle.
+ */
+auto cancel_releases(std::uint32_t start, std::uint32_t delay,
+                     std::uint32_t cancel_after) -> bool {
+  Wheel wheel;
+  advance(wheel, start);
+  Expiry expiry{&wheel};
+  auto timer = std::make_unique<Timer>(record, &expiry);
+  wheel.arm_after(*timer, delay);
+  advance(wheel, cancel_after);
+  bool ok = wheel.cancel(*timer) && !Wheel::is_idle(*timer);
+  wheel.tick();
+  ok = ok && Wheel::is_idle(*timer) && !wheel.cancel(*timer);
+  timer.reset();
+  advance(wheel, kMaxDelay * 2);
+  return check(ok && expiry.count == 0, "cancel", start, delay, cancel_after);
+}
+
+/**
+ * @brief Cancels a timer and arms it again with another delay, with or
+ * without a tick in between, and checks that only the second deadline
+ * expires.
+ */
+auto cancel_rearm(std::uint32_t start, std::uint32_t delay,
+                  std::uint32_t rearm_delay, bool tick_between) -> bool {
+  Wheel wheel;
+  advance(wheel, start);
+  Expiry expiry{&wheel};
+  Timer timer(record, &expiry);
+  wheel.arm_after(timer, delay);
+  advance(wheel, delay / 2);
+  bool ok = wheel.cancel(timer);
+  if (tick_between) {
+    wheel.tick();
+  }
+  const auto expected = wheel.now() + rearm_delay;
+  wheel.arm_after(timer, rearm_delay);
+  advance(wheel, kMaxDelay * 2);
+  return check(ok && expiry.count == 1 && expiry.at == expected &&
+                   Wheel::is_idle(timer),
+               tick_between ? "cancel, tick and re-arm" : "cancel and re-arm",
+               start, delay, rearm_delay);
+}
+
+/**
+ * @brief Arms an armed timer again, moving its deadline to another level.
+ */
+auto rearm_moves(std::uint32_t start, std::uint32_t delay,
+                 std::uint32_t rearm_delay) -> bool {
+  Wheel wheel;
+  advance(wheel, start);
+  Expiry expiry{&wheel};
+  Timer timer(record, &expiry);
+  wheel.arm_after(timer, delay);
+  advance(wheel, delay / 2);
+  const auto expected = wheel.now() + rearm_delay;
+  wheel.arm_after(timer, rearm_delay);
+  advance(wheel, kMaxDelay * 2);
+  return check(expiry.count == 1 && expiry.at == expected, "re-arm", start,
+               delay, rearm_delay);
+}
+
+}  // namespace
+
+auto main() -> int {
+  // Starting points just before, at and after the cascades of each level
+  constexpr std::uint32_t kStarts[] = {0, 3, 4, 15, 16, 17, 63, 64, 65};
+
+  bool passed = true;
+  for (const auto start : kStarts) {
+    for (std::uint32_t delay = 0; delay <= kMaxDelay; delay++) {
+      passed = arm_expires(start, delay) && passed;
+    }
+    for (std::uint32_t delay = 2; delay <= kMaxDelay; delay++) {
+      for (std::uint32_t cancel_after = 0; cancel_after < delay;
+           cancel_after++) {
+        passed = cancel_releases(start, delay, cancel_after) && passed;
+      }
+      for (std::uint32_t rearm_delay = 1; rearm_delay <= kMaxDelay;
+           rearm_delay++) {
+        passed = cancel_rearm(start, delay, rearm_delay, false) && passed;
+        passed = cancel_rearm(start, delay, rearm_delay, true) && passed;
+        passed = rearm_moves(start, delay, rearm_delay) && passed;
+      }
+    }
+  }
+  std::printf("%s timer wheel\n", passed ? "ok  " : "FAIL");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2023 Francisco Javier Alvarez Garcia
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+"""Reports the call sites of atomic intrinsics in a linked firmware ELF.
+
+Every call to an `__atomic_*` or `__sync_*` symbol is grouped by the calling
+function and annotated with the number of cycles it spends with interrupts
+masked, according to the cost table below. Call sites that end up in the
+`critical_section()` path are flagged, together with the reason. Symbols that
+are not in the cost table are reported as unknown.
+
+The build configuration of the library changes which paths are taken, so it
+can be given on the command line: the backend bound by the runtime dispatch,
+whether it is built for multi-core parts, and whether the atomics may be
+unaligned.
+
+Usage:
+    atomic_callsites.py firmware.elf [--objdump arm-none-eabi-objdump] [--json]
+        [--backend {primask,exclusive,acquire-release}] [--multicore]
+        [--unaligned]
+"""
+
+import argparse
+import collections
+import json
+import re
+import subprocess
+import sys
+
+# Cycle costs of the instructions found inside the masked windows of
+# src/atomic.cpp, taken from the Cortex-M0/M0+ technical reference manuals.
+CYCLES_LDR = 2
+CYCLES_STR = 2
+CYCLES_ALU = 1
+CYCLES_DMB = 4
+# Uncontended application spinlock taken by every critical section of
+# multi-core builds, e.g. one read and one write of an RP2040 SIO spinlock
+CYCLES_SPINLOCK = CYCLES_LDR + CYCLES_STR
+
+ORDER_NAMES = {
+    0: "relaxed",
+    1: "consume",
+    2: "acquire",
+    3: "release",
+    4: "acq_rel",
+    5: "seq_cst",
+}
+SEQ_CST = 5
+
+
+def store_fences(order):
+    """Number of DMBs emitted by `atomic_store<T>` for the given order."""
+    pre = 1 if order != 0 else 0
+    post = 1 if order in (2, 4, 5) else 0
+    return pre + post
+
+
+def load_fences(order):
+    """Number of DMBs emitted by `atomic_load<T>` for the given order."""
+    pre = 1 if order in (3, 4, 5) else 0
+    post = 1 if order != 0 else 0
+    return pre + post
+
+
+def rmw_fences(order):
+    """Number of DMBs emitted by the read-modify-write intrinsics."""
+    return 2 if order != 0 else 0
+
+
+# Per-intrinsic cost table. Keys are (operation, size in bytes). Each entry
+# holds whether the intrinsic runs inside `critical_section()`, the cycles of
+# the memory accesses performed with interrupts masked, a function mapping the
+# memory order to the number of fences, and the index of the register holding
+# the memory order argument (None if it is passed on the stack).
+#
+# This table mirrors src/atomic.cpp and must be kept in sync with it. The
+# changes made by the build configuration are applied by masked_window().
+Cost = collections.namedtuple("Cost",
+                              ["masked", "access_cycles", "fences", "order_reg"])
+
+COST_TABLE = {
+    ("store", 1): Cost(False, CYCLES_STR, store_fences, 2),
+    ("store", 2): Cost(False, CYCLES_STR, store_fences, 2),
+    ("store", 4): Cost(False, CYCLES_STR, store_fences, 2),
+    ("store", 8): Cost(True, 2 * CYCLES_STR, store_fences, None),
+    ("load", 1): Cost(False, CYCLES_LDR, load_fences, 1),
+    ("load", 2): Cost(False, CYCLES_LDR, load_fences, 1),
+    ("load", 4): Cost(False, CYCLES_LDR, load_fences, 1),
+    ("load", 8): Cost(True, 2 * CYCLES_LDR, load_fences, 1),
+    ("exchange", 1): Cost(True, CYCLES_LDR + CYCLES_STR, rmw_fences, 2),
+    ("exchange", 2): Cost(True, CYCLES_LDR + CYCLES_STR, rmw_fences, 2),
+    ("exchange", 4): Cost(True, CYCLES_LDR + CYCLES_STR, rmw_fences, 2),
+    ("exchange", 8): Cost(True, 2 * (CYCLES_LDR + CYCLES_STR), rmw_fences,
+                          None),
+    ("compare_exchange", 1): Cost(True, CYCLES_LDR + CYCLES_ALU + CYCLES_STR,
+                                  rmw_fences, 3),
+    ("compare_exchange", 2): Cost(True, CYCLES_LDR + CYCLES_ALU + CYCLES_STR,
+                                  rmw_fences, 3),
+    ("compare_exchange", 4): Cost(True, CYCLES_LDR + CYCLES_ALU + CYCLES_STR,
+                                  rmw_fences, 3),
+    ("compare_exchange", 8): Cost(True,
+                                  2 * (CYCLES_LDR + CYCLES_ALU + CYCLES_STR),
+                                  rmw_fences, None),
+}
+
+# The fetch_<op> and <op>_fetch intrinsics all share the same cost.
+for _op in ("add", "sub", "and", "or", "xor"):
+    for _name in ("fetch_" + _op, _op + "_fetch"):
+        for _size in (1, 2, 4):
+            COST_TABLE[(_name, _size)] = Cost(
+                True, CYCLES_LDR + CYCLES_ALU + CYCLES_STR, rmw_fences, 2)
+        COST_TABLE[(_name, 8)] = Cost(
+            True, 2 * (CYCLES_LDR + CYCLES_ALU + CYCLES_STR), rmw_fences, None)
+
+BACKENDS = ("primask", "exclusive", "acquire-release")
+
+# Build configuration of the library. The backend is the one bound by the
+# runtime dispatch (src/dispatch.cpp), which is always "primask" without it.
+Config = collections.namedtuple("Config",
+                                ["backend", "multicore", "unaligned"])
+DEFAULT_CONFIG = Config("primask", False, False)
+
+# Worst case window with interrupts masked of a call site, and why it masks
+Window = collections.namedtuple("Window", ["cycles", "reasons"])
+
+
+def masked_window(op, size, order, config):
+    """Returns the masked Window of a known intrinsic or None if it does not
+    mask interrupts under the given configuration."""
+    cost = COST_TABLE[(op, size)]
+    rmw = op not in ("load", "store")
+    access_cycles = cost.access_cycles
+    # Whether the fences are emitted with interrupts masked
+    fences_masked = True
+
+    if config.unaligned and size > 1:
+        # Unaligned values are accessed byte by byte with interrupts masked
+        # on every backend. Loads and stores only mask around the accesses.
+        reasons = ["unaligned"]
+        if rmw:
+            access_cycles = size * (CYCLES_LDR + CYCLES_STR) + CYCLES_ALU
+        else:
+            access_cycles = size * (CYCLES_LDR if op == "load" else CYCLES_STR)
+            fences_masked = size == 8
+    elif cost.masked and rmw and size <= 4 and config.backend != "primask":
+        # The exclusive backends only mask interrupts once they run out of
+        # attempts, and issue their fences outside of that window
+        reasons = ["exclusive fallback"]
+        fences_masked = False
+    elif cost.masked:
+        reasons = ["rmw" if rmw else "size"]
+    elif config.multicore and op == "store" and (
+            config.backend != "acquire-release" or order == 0):
+        # Stores take the spinlock so that they cannot land in the middle of
+        # a read-modify-write operation of another core, except for the stl
+        # of the acquire/release backend
+        reasons = ["multicore"]
+        fences_masked = False
+    else:
+        return None
+
+    cycles = access_cycles
+    if config.multicore:
+        cycles += CYCLES_SPINLOCK
+    fences = cost.fences(order) if fences_masked else 0
+    if fences > 0:
+        cycles += fences * CYCLES_DMB
+        reasons.append("order:{}".format(ORDER_NAMES.get(order, "?")))
+    return Window(cycles, reasons)
+
+
+INTRINSIC_RE = re.compile(r"^__(atomic|sync)_(\w+?)(?:_(\d))?$")
+FUNCTION_RE = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+INSTRUCTION_RE = re.compile(r"^\s*([0-9a-f]+):\s+(\S+)\s*(.*)$")
+CALL_TARGET_RE = re.compile(r"<([^>+]+)>")
+MOV_IMM_RE = re.compile(r"^r(\d+),\s*#(\d+)")
+
+CALL_MNEMONICS = ("bl", "blx", "b", "b.n", "b.w")
+# Instructions after which the value of the order register can no longer be
+# traced back from the call site.
+BARRIER_MNEMONICS = ("bl", "blx", "bx", "pop", "b", "b.n", "b.w")
+MAX_LOOKBACK = 8
+
+
+class CallSite:
+
+    def __init__(self,
+                 caller,
+                 address,
+                 symbol,
+                 op,
+                 size,
+                 order,
+                 config=DEFAULT_CONFIG):
+        self.caller = caller
+        self.address = address
+        self.symbol = symbol
+        self.op = op
+        self.size = size
+        self.order = order
+        self.cost = COST_TABLE.get((op, size))
+        self.window = masked_window(op, size, self.assumed_order,
+                                    config) if self.cost else None
+
+    @property
+    def known(self):
+        return self.cost is not None
+
+    @property
+    def assumed_order(self):
+        # Unknown orders are accounted as seq_cst, which is the worst case
+        return SEQ_CST if self.order is None else self.order
+
+    @property
+    def masked_cycles(self):
+        return self.window.cycles if self.window else 0
+
+    @property
+    def critical_section(self):
+        """Whether the call site takes the `critical_section()` path, or None
+        if the symbol is not in the cost table."""
+        if not self.known:
+            return None
+        return self.window is not None
+
+    @property
+    def reasons(self):
+        """Why this call site takes the `critical_section()` path."""
+        return self.window.reasons if self.window else []
+
+    def flags(self):
+        if not self.known:
+            return "[unknown]"
+        if self.window:
+            return "[critical_section: {}]".format(", ".join(self.reasons))
+        return ""
+
+    def to_dict(self):
+        return {
+            "caller": self.caller,
+            "address": "0x{:08x}".format(self.address),
+            "symbol": self.symbol,
+            "order": ORDER_NAMES.get(self.order) if self.order is not None
+                     else None,
+            "masked_cycles": self.masked_cycles,
+            "critical_section": self.critical_section,
+            "reasons": self.reasons,
+        }
+
+
+def parse_intrinsic(symbol):
+    """Returns (operation, size) for an atomic intrinsic symbol or None."""
+    match = INTRINSIC_RE.match(symbol)
+    if not match:
+        return None
+    op = match.group(2)
+    size = int(match.group(3)) if match.group(3) else 0
+    return op, size
+
+
+def trace_order(history, register):
+    """Looks backwards from a call for a constant moved into `register`."""
+    if register is None:
+        return None
+    for mnemonic, operands in reversed(history[-MAX_LOOKBACK:]):
+        if mnemonic in BARRIER_MNEMONICS:
+            return None
+        match = MOV_IMM_RE.match(operands)
+        if match and int(match.group(1)) == register:
+            if mnemonic.startswith("mov"):
+                return int(match.group(2))
+            return None
+        if operands.startswith("r{},".format(register)):
+            # Register written by something other than an immediate move
+            return None
+    return None
+
+
+def find_call_sites(disassembly, config=DEFAULT_CONFIG):
+    sites = []
+    caller = None
+    history = []
+    for line in disassembly.splitlines():
+        function = FUNCTION_RE.match(line)
+        if function:
+            caller = function.group(2)
+            history = []
+            continue
+
+        instruction = INSTRUCTION_RE.match(line)
+        if not instruction or caller is None:
+            continue
+
+        address = int(instruction.group(1), 16)
+        mnemonic = instruction.group(2).split(".")[0] \
+            if instruction.group(2).startswith("mov") else instruction.group(2)
+        operands = instruction.group(3)
+
+        if mnemonic in CALL_MNEMONICS:
+            target = CALL_TARGET_RE.search(operands)
+            if target:
+                intrinsic = parse_intrinsic(target.group(1))
+                # Intrinsics calling each other are not interesting
+                if intrinsic and not parse_intrinsic(caller):
+                    op, size = intrinsic
+                    cost = COST_TABLE.get(intrinsic)
+                    order = trace_order(history, cost.order_reg) \
+                        if cost else None
+                    sites.append(
+                        CallSite(caller, address, target.group(1), op, size,
+                                 order, config))
+
+        history.append((mnemonic, operands))
+    return sites
+
+
+def disassemble(objdump, elf):
+    try:
+        return subprocess.run([objdump, "-d", "-C", "--no-show-raw-insn", elf],
+                              check=True,
+                              capture_output=True,
+                              text=True).stdout
+    except FileNotFoundError:
+        sys.exit("error: could not run {}".format(objdump))
+    except subprocess.CalledProcessError as error:
+        sys.exit("error: {} failed:\n{}".format(objdump, error.stderr))
+
+
+def group_by_caller(sites):
+    groups = collections.defaultdict(list)
+    for site in sites:
+        groups[site.caller].append(site)
+    return sorted(groups.items(),
+                  key=lambda item: sum(s.masked_cycles for s in item[1]),
+                  reverse=True)
+
+
+def print_report(groups):
+    for caller, sites in groups:
+        total = sum(site.masked_cycles for site in sites)
+        worst = max(site.masked_cycles for site in sites)
+        print("{}: {} call sites, {} masked cycles (worst {})".format(
+            caller, len(sites), total, worst))
+        for site in sorted(sites, key=lambda s: s.address):
+            order = ORDER_NAMES.get(site.order, "?") \
+                if site.order is not None else "?"
+            print("  0x{:08x} {:<28} order={:<8} masked={:<3} {}".format(
+                site.address, site.symbol, order, site.masked_cycles,
+                site.flags()))
+        print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="linked firmware image")
+    parser.add_argument("--objdump",
+                        default="arm-none-eabi-objdump",
+                        help="objdump binary for the target")
+    parser.add_argument("--json",
+                        action="store_true",
+                        help="print the report as JSON")
+    parser.add_argument("--backend",
+                        choices=BACKENDS,
+                        default="primask",
+                        help="backend bound by the runtime dispatch")
+    parser.add_argument("--multicore",
+                        action="store_true",
+                        help="library built with CORTEX_M_ATOMICS_MULTICORE")
+    parser.add_argument("--unaligned",
+                        action="store_true",
+                        help="account for unaligned atomics")
+    args = parser.parse_args()
+
+    config = Config(args.backend, args.multicore, args.unaligned)
+    sites = find_call_sites(disassemble(args.objdump, args.elf), config)
+    groups = group_by_caller(sites)
+
+    if args.json:
+        json.dump(
+            {caller: [s.to_dict() for s in sites] for caller, sites in groups},
+            sys.stdout,
+            indent=2)
+        print()
+    else:
+        print_report(groups)
+
+
+if __name__ == "__main__":
+    main()